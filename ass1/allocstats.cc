@@ -0,0 +1,79 @@
+/**
+ * File: allocstats.cc
+ * -------------------
+ * Replaces the global operator new and operator delete with versions
+ * that tally every allocation before passing it along to malloc.
+ * The array and nothrow forms of operator new that the standard
+ * library provides are all layered over the plain form, so
+ * replacing that one (and its matching deletes) catches everything.
+ * None of it is compiled unless ALLOC_STATS is defined.
+ */
+
+#include "allocstats.h"
+
+#ifndef ALLOC_STATS
+
+bool allocationCountingEnabled() { return false; }
+long getAllocationCount() { return 0; }
+long getAllocatedBytes() { return 0; }
+
+#else
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+using namespace std;
+
+static atomic<long> allocationCount(0);
+static atomic<long> allocatedBytes(0);
+
+bool allocationCountingEnabled()
+{
+  return true;
+}
+
+long getAllocationCount()
+{
+  return allocationCount.load(memory_order_relaxed);
+}
+
+long getAllocatedBytes()
+{
+  return allocatedBytes.load(memory_order_relaxed);
+}
+
+void *operator new(size_t size)
+{
+  allocationCount.fetch_add(1, memory_order_relaxed);
+  allocatedBytes.fetch_add(size, memory_order_relaxed);
+  void *memory = malloc(size == 0 ? 1 : size);
+  if (memory == NULL) throw bad_alloc();
+  return memory;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+  free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+#endif // ALLOC_STATS
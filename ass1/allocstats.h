@@ -0,0 +1,45 @@
+#ifndef __allocstats__
+#define __allocstats__
+
+/**
+ * File: allocstats.h
+ * ------------------
+ * Counts every allocation made through the global operator new
+ * (which is where all of the STL containers and strings get their
+ * memory), so that the cost of loading a grammar and of expanding
+ * it can be measured in allocations rather than guessed at.  The
+ * counters are atomic, so they stay accurate when several threads
+ * allocate at once.
+ *
+ * Counting costs every allocation a pair of atomic adds, so it's
+ * only compiled in when ALLOC_STATS is defined, which the Makefile
+ * does for the separate rsg-alloc-stats binary ("make rsg-alloc-stats").
+ * Plain rsg uses the standard operator new, and its counters stay at 0.
+ */
+
+/**
+ * Function: allocationCountingEnabled
+ * -----------------------------------
+ * Returns true if and only if this build counts allocations.
+ */
+
+bool allocationCountingEnabled();
+
+/**
+ * Function: getAllocationCount
+ * ----------------------------
+ * Returns the number of allocations made since the program started.
+ */
+
+long getAllocationCount();
+
+/**
+ * Function: getAllocatedBytes
+ * ---------------------------
+ * Returns the total number of bytes requested by those allocations.
+ * Nothing is subtracted when memory is released.
+ */
+
+long getAllocatedBytes();
+
+#endif // ! __allocstats__
@@ -0,0 +1,86 @@
+/**
+ * File: arena.cc
+ * --------------
+ * Provides the implementation of the Arena class.  Allocations are
+ * served by bumping a pointer through the current block.  When the
+ * current block can't satisfy a request, a fresh block is claimed;
+ * whatever was left over in the old one is simply abandoned.
+ */
+
+#include "arena.h"
+#include <cassert>
+#include <cstring>
+#include <stdint.h>
+using namespace std;
+
+static const size_t kBlockSize = 16 * 1024;
+
+Arena::Arena() : next(NULL), remaining(0), bytesUsed(0) {}
+
+Arena::~Arena()
+{
+  for (size_t i = 0; i < blocks.size(); i++) delete[] blocks[i];
+}
+
+/**
+ * Method: allocate
+ * ----------------
+ * Requests too large to share a block get a block all their own,
+ * so the current block isn't abandoned on their account.
+ */
+
+void *Arena::allocate(size_t numBytes, size_t alignment)
+{
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  size_t padding = -(uintptr_t) next & (alignment - 1);
+  if (padding + numBytes > remaining) {
+    if (numBytes + alignment > kBlockSize / 4) {
+      char *block = new char[numBytes + alignment];
+      blocks.push_back(block);
+      bytesUsed += numBytes;
+      return block + (-(uintptr_t) block & (alignment - 1));
+    }
+    next = new char[kBlockSize];
+    remaining = kBlockSize;
+    blocks.push_back(next);
+    padding = -(uintptr_t) next & (alignment - 1);
+  }
+
+  char *result = next + padding;
+  next += padding + numBytes;
+  remaining -= padding + numBytes;
+  bytesUsed += numBytes;
+  return result;
+}
+
+const char *Arena::intern(const string& str)
+{
+  unordered_set<const char *, StringHash, StringEqual>::const_iterator found = interned.find(str.c_str());
+  if (found != interned.end()) return *found;
+
+  char *copy = static_cast<char *>(allocate(str.size() + 1, 1));
+  memcpy(copy, str.c_str(), str.size() + 1);
+  interned.insert(copy);
+  return copy;
+}
+
+/**
+ * Method: StringHash::operator()
+ * ------------------------------
+ * 32-bit FNV-1a over the characters of the string.
+ */
+
+size_t Arena::StringHash::operator()(const char *str) const
+{
+  uint32_t hash = 2166136261u;
+  for (; *str != '\0'; str++) {
+    hash ^= (unsigned char) *str;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+bool Arena::StringEqual::operator()(const char *one, const char *two) const
+{
+  return strcmp(one, two) == 0;
+}
@@ -0,0 +1,96 @@
+#ifndef __arena__
+#define __arena__
+
+/**
+ * File: arena.h
+ * -------------
+ * Defines the Arena class, a region allocator that carves small
+ * allocations out of large blocks and releases them all at once
+ * when the Arena itself is destroyed.  A grammar's items (the
+ * terminal and nonterminal strings, and the arrays that sequence
+ * them into Productions) are all allocated out of a single Arena,
+ * so loading a grammar costs a handful of block allocations rather
+ * than one allocation per word.
+ *
+ * Strings placed in an Arena are interned: asking for the same
+ * text twice hands back the very same pointer, so two items spell
+ * the same word if and only if they're the same address.
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_set>
+using namespace std;
+
+class Arena {
+
+ public:
+
+  /**
+   * Constructor: Arena
+   * ------------------
+   * Constructs an empty Arena.  No memory is claimed until
+   * the first allocation.
+   */
+
+  Arena();
+
+  /**
+   * Destructor: ~Arena
+   * ------------------
+   * Releases every block, and with them everything ever
+   * allocated out of the Arena.
+   */
+
+  ~Arena();
+
+  /**
+   * Method: allocate
+   * ----------------
+   * Returns the address of numBytes of uninitialized memory aligned
+   * on an alignment-byte boundary (alignment must be a power of two).
+   * The memory stays valid for as long as the Arena does.
+   */
+
+  void *allocate(size_t numBytes, size_t alignment = sizeof(void *));
+
+  /**
+   * Method: intern
+   * --------------
+   * Returns a '\0'-terminated copy of the specified string that lives
+   * in the Arena.  Every call with the same text returns the same copy.
+   */
+
+  const char *intern(const string& str);
+
+  /**
+   * Methods: getBytesUsed, getNumBlocks
+   * -----------------------------------
+   * Report how many bytes have been handed out so far, and how
+   * many blocks were needed to hold them.
+   */
+
+  size_t getBytesUsed() const { return bytesUsed; }
+  int getNumBlocks() const { return blocks.size(); }
+
+ private:
+  Arena(const Arena& other) = delete;
+  Arena& operator=(const Arena& other) = delete;
+
+  struct StringHash {
+    size_t operator()(const char *str) const;
+  };
+
+  struct StringEqual {
+    bool operator()(const char *one, const char *two) const;
+  };
+
+  vector<char *> blocks;
+  char *next;
+  size_t remaining;
+  size_t bytesUsed;
+  unordered_set<const char *, StringHash, StringEqual> interned;
+};
+
+#endif // ! __arena__
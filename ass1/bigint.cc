@@ -0,0 +1,152 @@
+/**
+ * File: bigint.cc
+ * ---------------
+ * Provides the implementation of the BigInt class, which stores
+ * its value as a sequence of 32-bit limbs and does all of its
+ * arithmetic in 64 bits, one limb at a time.
+ */
+
+#include "bigint.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+using namespace std;
+
+BigInt::BigInt(uint32_t value)
+{
+  if (value != 0) limbs.push_back(value);
+}
+
+void BigInt::trim()
+{
+  while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+}
+
+BigInt& BigInt::operator+=(const BigInt& other)
+{
+  if (limbs.size() < other.limbs.size()) limbs.resize(other.limbs.size(), 0);
+  uint64_t carry = 0;
+  for (size_t i = 0; i < limbs.size(); i++) {
+    uint64_t sum = carry + limbs[i] + (i < other.limbs.size() ? other.limbs[i] : 0);
+    limbs[i] = static_cast<uint32_t>(sum);
+    carry = sum >> 32;
+    if (carry == 0 && i >= other.limbs.size()) break;
+  }
+  if (carry != 0) limbs.push_back(static_cast<uint32_t>(carry));
+  return *this;
+}
+
+BigInt& BigInt::operator-=(const BigInt& other)
+{
+  assert(compare(other) >= 0);
+  int64_t borrow = 0;
+  for (size_t i = 0; i < limbs.size(); i++) {
+    int64_t difference = static_cast<int64_t>(limbs[i]) - borrow - (i < other.limbs.size() ? other.limbs[i] : 0);
+    borrow = difference < 0 ? 1 : 0;
+    limbs[i] = static_cast<uint32_t>(difference + (borrow << 32));
+    if (borrow == 0 && i >= other.limbs.size()) break;
+  }
+  trim();
+  return *this;
+}
+
+BigInt BigInt::operator*(const BigInt& other) const
+{
+  BigInt product;
+  if (isZero() || other.isZero()) return product;
+  product.limbs.assign(limbs.size() + other.limbs.size(), 0);
+  for (size_t i = 0; i < limbs.size(); i++) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < other.limbs.size(); j++) {
+      uint64_t partial = static_cast<uint64_t>(limbs[i]) * other.limbs[j] + product.limbs[i + j] + carry;
+      product.limbs[i + j] = static_cast<uint32_t>(partial);
+      carry = partial >> 32;
+    }
+    product.limbs[i + other.limbs.size()] = static_cast<uint32_t>(carry);
+  }
+  product.trim();
+  return product;
+}
+
+int BigInt::compare(const BigInt& other) const
+{
+  if (limbs.size() != other.limbs.size()) return limbs.size() < other.limbs.size() ? -1 : 1;
+  for (size_t i = limbs.size(); i > 0; i--) {
+    if (limbs[i - 1] != other.limbs[i - 1]) return limbs[i - 1] < other.limbs[i - 1] ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Method: divide
+ * --------------
+ * Divides the BigInt in place by a small divisor, and
+ * returns the remainder.
+ */
+
+uint32_t BigInt::divide(uint32_t divisor)
+{
+  uint64_t remainder = 0;
+  for (size_t i = limbs.size(); i > 0; i--) {
+    uint64_t current = (remainder << 32) | limbs[i - 1];
+    limbs[i - 1] = static_cast<uint32_t>(current / divisor);
+    remainder = current % divisor;
+  }
+  trim();
+  return static_cast<uint32_t>(remainder);
+}
+
+/**
+ * Method: toString
+ * ----------------
+ * Peels off nine decimal digits at a time, least significant
+ * group first, and then reverses the whole thing.
+ */
+
+string BigInt::toString() const
+{
+  if (isZero()) return "0";
+  BigInt remaining = *this;
+  string digits;
+  while (!remaining.isZero()) {
+    uint32_t group = remaining.divide(1000000000);
+    for (int i = 0; i < 9 && (group != 0 || !remaining.isZero()); i++) {
+      digits += static_cast<char>('0' + group % 10);
+      group /= 10;
+    }
+  }
+  reverse(digits.begin(), digits.end());
+  return digits;
+}
+
+/**
+ * Function: getRandomBelow
+ * ------------------------
+ * Draws random limbs until the result falls below the bound.  The top
+ * limb is masked down to the bound's bit length, so each draw lands
+ * below the bound at least half of the time.
+ */
+
+BigInt BigInt::getRandomBelow(const BigInt& bound, RandomGenerator& random)
+{
+  assert(!bound.isZero());
+  uint32_t top = bound.limbs.back();
+  uint32_t mask = 0xffffffffu;
+  while ((mask >> 1) >= top) mask >>= 1;
+
+  BigInt result;
+  do {
+    result.limbs.resize(bound.limbs.size());
+    for (size_t i = 0; i < result.limbs.size(); i++) {
+      result.limbs[i] = static_cast<uint32_t>(random.getRandomInteger(INT_MIN, INT_MAX));
+    }
+    result.limbs.back() &= mask;
+    result.trim();
+  } while (result.compare(bound) >= 0);
+  return result;
+}
+
+ostream& operator<<(ostream& out, const BigInt& value)
+{
+  return out << value.toString();
+}
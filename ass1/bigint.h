@@ -0,0 +1,92 @@
+#ifndef __bigint__
+#define __bigint__
+
+/**
+ * File: bigint.h
+ * --------------
+ * Defines the BigInt class, an arbitrarily large non-negative
+ * integer.  Counting the sentences a grammar can generate
+ * overflows any built-in integer type almost immediately, but
+ * the counts only ever need to be added, multiplied, compared,
+ * subtracted (never below zero), printed, and used as the bound
+ * on a random draw, so that's all a BigInt supports.
+ */
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "random.h"
+using namespace std;
+
+class BigInt {
+
+ public:
+
+  /**
+   * Constructor: BigInt
+   * -------------------
+   * Constructs a BigInt with the specified (small) value.
+   */
+
+  BigInt(uint32_t value = 0);
+
+  /**
+   * Method: isZero
+   * --------------
+   * Returns true if and only if the BigInt is 0.
+   */
+
+  bool isZero() const { return limbs.empty(); }
+
+  /**
+   * Operators: +=, -=, *
+   * --------------------
+   * The usual arithmetic.  Subtracting a larger BigInt
+   * from a smaller one asserts and ends the program.
+   */
+
+  BigInt& operator+=(const BigInt& other);
+  BigInt& operator-=(const BigInt& other);
+  BigInt operator*(const BigInt& other) const;
+
+  /**
+   * Method: compare
+   * ---------------
+   * Returns a negative number, zero, or a positive number
+   * depending on whether this BigInt is less than, equal
+   * to, or greater than the other one.
+   */
+
+  int compare(const BigInt& other) const;
+
+  bool operator<(const BigInt& other) const { return compare(other) < 0; }
+  bool operator==(const BigInt& other) const { return compare(other) == 0; }
+
+  /**
+   * Method: toString
+   * ----------------
+   * Returns the decimal representation of the BigInt.
+   */
+
+  string toString() const;
+
+  /**
+   * Function: getRandomBelow
+   * ------------------------
+   * Returns a BigInt drawn uniformly from [0, bound), which
+   * must not be empty.
+   */
+
+  static BigInt getRandomBelow(const BigInt& bound, RandomGenerator& random);
+
+ private:
+  void trim();
+  uint32_t divide(uint32_t divisor);
+
+  vector<uint32_t> limbs;      // least significant first, never a leading 0
+};
+
+ostream& operator<<(ostream& out, const BigInt& value);
+
+#endif // ! __bigint__
@@ -0,0 +1,41 @@
+A left-recursive grammar, for checking that rsg --count, --enumerate
+and --uniform handle left recursion: <list> mentions itself first, but
+only ever with a terminal after it, so it can't derive itself without
+producing anything, and it has finitely many derivations of every
+length.  <maybe-ripe> can produce nothing at all, which is fine too.
+
+"rsg --count 8 left-recursive.g" should report, by length,
+
+       2  3
+       3  1
+       4  9
+       5  6
+       6  28
+       7  27
+       8  90
+
+for 164 derivations in all.
+
+{
+<start>
+<list> . ;
+}
+
+{
+<list>
+<list> and <item> ;
+<item> ;
+}
+
+{
+<item>
+apples ;
+pears ;
+<maybe-ripe> plums ;
+}
+
+{
+<maybe-ripe>
+ ;
+ripe ;
+}
@@ -0,0 +1,52 @@
+A weighted grammar, for checking that a compiled grammar image makes
+exactly the same choices as the text grammar it was compiled from:
+
+    rsg compile weighted.g weighted.rsgc
+    rsg --seed 7 weighted.g
+    rsg --seed 7 run weighted.rsgc
+
+should print the same three sentences (make check does this for a
+range of seeds).  The weights are lopsided, so every alias table has
+columns that hand draws over to other productions.
+
+{
+<start>
+<clause> . ;
+}
+
+{
+<clause>
+the <animal> <verb> <place> ; 3
+<clause> , and then <clause> ;
+}
+
+{
+<animal>
+cat ; 7
+dog ; 3
+heron ;
+wombat ; 12
+}
+
+{
+<verb>
+sat ; 40
+slept ; 25
+hid ; 2
+waited ;
+sang ; 9
+}
+
+{
+<place>
+on the mat ; 5
+under the <thing> ; 3
+by the <thing> ; 1
+}
+
+{
+<thing>
+table ;
+bridge ; 1000
+stairs ; 17
+}
@@ -9,6 +9,8 @@
  
 #include "definition.h"
 #include "random.h"
+#include <climits>
+#include <utility>
 
 /**
  * Constructor: Definition
@@ -21,7 +23,7 @@
  * poised to read the opening '{' as the very first character.
  */
 
-Definition::Definition(ifstream& infile)
+Definition::Definition(ifstream& infile, Arena& arena) : totalWeight(0)
 {
   string uselessText;
   getline(infile, uselessText, '{');
@@ -29,11 +31,56 @@ Definition::Definition(ifstream& infile)
   getline(infile, uselessText); // stop character defaults to '\n'
 
   while (infile.peek() != '}') {
-    Production possibleExpansion(infile);
-    possibleExpansions.push_back(possibleExpansion);
+    possibleExpansions.push_back(Production(infile, arena));
   }
   
   getline(infile, uselessText, '}');
+  buildAliasTable();
+}
+
+/**
+ * Method: buildAliasTable
+ * -----------------------
+ * Builds Walker's alias table using Vose's two-worklist construction.
+ * Every weight is scaled by the number of Productions n, so that an
+ * evenly filled column holds exactly totalWeight.  Columns holding less
+ * than that are topped off by some column holding more, which is
+ * recorded as the alias.  Everything stays in integers, so the table
+ * (and every choice made against it) is the same on every platform.
+ * The weights come straight from the grammar file, so the table is
+ * kept in 64 bits: n weights of up to INT_MAX each, scaled by n, can't
+ * overflow it for any grammar that fits in memory.
+ */
+
+void Definition::buildAliasTable()
+{
+  int n = possibleExpansions.size();
+  long long total = 0;
+  for (int i = 0; i < n; i++) total += possibleExpansions[i].getWeight();
+  totalWeight = total;
+
+  vector<long long> scaled(n);
+  vector<int> small, large;
+  for (int i = 0; i < n; i++) {
+    scaled[i] = (long long) possibleExpansions[i].getWeight() * n;
+    if (scaled[i] < total) small.push_back(i);
+    else large.push_back(i);
+  }
+
+  thresholds.assign(n, totalWeight);
+  aliases.resize(n);
+  for (int i = 0; i < n; i++) aliases[i] = i;
+  while (!small.empty() && !large.empty()) {
+    int less = small.back(); small.pop_back();
+    int more = large.back();
+    thresholds[less] = scaled[less];
+    aliases[less] = more;
+    scaled[more] -= total - scaled[less];
+    if (scaled[more] < total) {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
 }
 
 /**
@@ -48,6 +95,62 @@ Definition::Definition(ifstream& infile)
 const Production& Definition::getRandomProduction() const
 {
   static RandomGenerator random; 
-  int randomIndex = random.getRandomInteger(0, possibleExpansions.size() - 1);
-  return possibleExpansions[randomIndex];
+  return getRandomProduction(random);
+}
+
+/**
+ * Method: getRandomProduction
+ * ---------------------------
+ * Picks a column of the alias table uniformly at random, and then
+ * decides between the column's own Production and its alias with a
+ * second draw.  Two draws, no matter how many Productions there are.
+ * Unweighted Definitions never need the second draw, and only
+ * Definitions whose weights add up to more than INT_MAX need the
+ * second one to be a 64-bit draw.
+ */
+
+const Production& Definition::getRandomProduction(RandomGenerator& random) const
+{
+  int column = random.getRandomInteger(0, possibleExpansions.size() - 1);
+  if (totalWeight == (int) possibleExpansions.size()) return possibleExpansions[column];
+  long long coin = (totalWeight <= INT_MAX) ? random.getRandomInteger(0, totalWeight - 1)
+                                            : random.getRandomLong(0, totalWeight - 1);
+  return possibleExpansions[coin < thresholds[column] ? column : aliases[column]];
+}
+
+/**
+ * Takes a reference to a legitimate infile (one that's been set up
+ * to layer over a file) and populates the grammar map with the
+ * collection of definitions that are spelled out in the referenced
+ * file.  The function is written under the assumption that the
+ * referenced data file is really a grammar file that's properly
+ * formatted.  You may assume that all grammars are in fact properly
+ * formatted.
+ *
+ * @param infile a valid reference to a flat text file storing the grammar.
+ * @param grammar a reference to the STL map, which maps nonterminal strings
+ *                to their definitions.
+ * @param arena the Arena holding every item of every Production.  It
+ *              must outlive the grammar.
+ * @param error where the reason is left if the grammar is rejected.
+ */
+
+bool readGrammar(ifstream& infile, map<string, Definition>& grammar, Arena& arena, string& error)
+{
+  while (true) {
+    string uselessText;
+    getline(infile, uselessText, '{');
+    if (infile.eof()) return true;  // true? we encountered EOF before we saw a '{': no more productions!
+    infile.putback('{');
+    Definition def(infile, arena);
+    for (int i = 0; i < def.size(); i++) {
+      if (def.getProduction(i).getWeight() <= 0) {
+        error = "Production " + to_string(i + 1) + " of " + def.getNonterminal() +
+                " has a weight that isn't a positive integer.";
+        return false;
+      }
+    }
+    Definition& slot = grammar[def.getNonterminal()];
+    slot = std::move(def);
+  }
 }
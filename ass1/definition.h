@@ -11,11 +11,24 @@
  */
 
 #include "production.h"
+#include "arena.h"
+#include "random.h"
 #include <vector>
+#include <map>
+#include <string>
 using namespace std;  
 
 class Definition {
   
+ public:
+  
+  /**
+   * Provides STL-like iterator access to the Productions
+   * making up a Definition instance.
+   */
+  
+  typedef vector<Production>::const_iterator const_iterator;
+  
  public:
   
   /**
@@ -29,7 +42,7 @@ class Definition {
    * requires its elements to have a default constructor.
    */
   
-  Definition() {}
+  Definition() : totalWeight(0) {}
   
   /**
    * ifstream Constructor: Definition
@@ -58,9 +71,23 @@ class Definition {
    *               an open curly brace as the next character.  If not, then
    *               the implementation makes no guarantees as to how the
    *               constructor behaves.
+   * @param arena the Arena that takes in every item of every Production.
+   *              It must outlive the Definition.
    */
   
-  Definition(ifstream& infile);
+  Definition(ifstream& infile, Arena& arena);
+  
+  /**
+   * Move Constructor and Assignment: Definition
+   * -------------------------------------------
+   * Definitions can be moved into a map but never copied,
+   * so no Production is ever duplicated once it's been read.
+   */
+  
+  Definition(Definition&& other) = default;
+  Definition& operator=(Definition&& other) = default;
+  Definition(const Definition& other) = delete;
+  Definition& operator=(const Definition& other) = delete;
 
   /**
    * Method: getNonterminal
@@ -80,7 +107,10 @@ class Definition {
    * ---------------------------
    * Returns an immutable reference to one and
    * exactly one of the Definition's expansions.
-   * The Production is chosen at random.
+   * The Production is chosen at random, with each Production's
+   * chances proportional to its weight.  The choice takes constant
+   * time regardless of the number of Productions, because it's made
+   * against the alias table built when the Definition was read.
    *
    * @return an immutable reference to a randomly selected
    *         Production held by the Definition.  It is assumed
@@ -89,9 +119,88 @@ class Definition {
   
   const Production& getRandomProduction() const;
   
+  /**
+   * Method: getRandomProduction
+   * ---------------------------
+   * Operates exactly like the version above, except that the
+   * random choices are drawn from the supplied generator.  Two
+   * generators constructed with the same seed lead to the very
+   * same sequence of Productions.
+   *
+   * @param random the generator from which the choice is drawn.
+   * @return an immutable reference to a randomly selected Production.
+   */
+  
+  const Production& getRandomProduction(RandomGenerator& random) const;
+  
+  /**
+   * Iterators: begin, end
+   * ---------------------
+   * Provides read-only traversal of all of the Definition's
+   * Productions, in the order they appeared in the grammar file.
+   */
+  
+  const_iterator begin() const { return possibleExpansions.begin(); }
+  const_iterator end() const { return possibleExpansions.end(); }
+  
+  /**
+   * Method: getProduction
+   * ---------------------
+   * Returns the Production at the specified position, where
+   * the first Production in the grammar file is at position 0.
+   */
+  
+  const Production& getProduction(int position) const { return possibleExpansions[position]; }
+  
+  /**
+   * Method: size
+   * ------------
+   * Returns the number of Productions held by the Definition.
+   */
+  
+  int size() const { return possibleExpansions.size(); }
+
+  /**
+   * Methods: getTotalWeight, getThreshold, getAlias
+   * -----------------------------------------------
+   * Expose the alias table described below, so that a compiled grammar
+   * image can carry the very same table and make the very same choices
+   * as getRandomProduction does for a given seed.
+   */
+
+  long long getTotalWeight() const { return totalWeight; }
+  long long getThreshold(int column) const { return thresholds[column]; }
+  int getAlias(int column) const { return aliases[column]; }
+
  private:
+  void buildAliasTable();
+  
   string nonterminal;
   vector<Production> possibleExpansions;
+  
+  /**
+   * Walker's alias table, scaled to integers so that sampling is
+   * exact and reproducible: column i keeps Production i whenever a
+   * number drawn from [0, totalWeight) falls below thresholds[i], and
+   * hands the draw to Production aliases[i] otherwise.
+   */
+  
+  vector<long long> thresholds;
+  vector<int> aliases;
+  long long totalWeight;
 };
 
+/**
+ * Function: readGrammar
+ * ---------------------
+ * Reads every Definition in the grammar file layered under infile
+ * into the grammar map, keyed by nonterminal.  Every item of every
+ * Production is interned into the Arena, which must outlive the map.
+ *
+ * @return false, with a message naming the offending Definition in
+ *         error, if some Production's weight isn't a positive integer.
+ */
+
+bool readGrammar(ifstream& infile, map<string, Definition>& grammar, Arena& arena, string& error);
+
 #endif // ! __definition__
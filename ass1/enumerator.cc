@@ -0,0 +1,356 @@
+/**
+ * File: enumerator.cc
+ * -------------------
+ * Provides the implementation of the Enumerator class.
+ *
+ * The number of derivations of a Production's items i, i+1, ... that
+ * produce exactly n terminals (its "suffix count") is the sum, over
+ * every split m, of the derivations of item i producing m terminals
+ * times the suffix count of items i+1, ... producing n - m.  The count
+ * for a nonterminal is the sum of the suffix counts of its Productions
+ * from item 0.  Both are memoized, so each is computed once.
+ *
+ * Listing and sampling both walk the same splits, skipping any whose
+ * count is zero, so no work is ever wasted on a dead end.
+ *
+ * Splits never hand item i more terminals than are left once items
+ * i+1, ... have had the fewest they can produce.  So a count can only
+ * be asked for again while it's still being computed by going around
+ * a cycle of items that produce no terminals at all.  Those cycles are
+ * found up front, from the minimum lengths, rather than being inferred
+ * from the recursion, which used to mistake ordinary left recursion
+ * (<list> -> <list> a) for one.
+ */
+
+#include "enumerator.h"
+#include <algorithm>
+#include <cassert>
+using namespace std;
+
+Enumerator::Enumerator(const map<string, Definition>& grammar, const GrammarAnalysis& analysis, int maxLength)
+  : maxLength(maxLength), zero(0), one(1)
+{
+  assert(maxLength >= 0);
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr) {
+    if (!analysis.isProductive(curr->first)) continue;
+    indices[curr->first] = symbols.size();
+    Symbol symbol;
+    symbol.name = curr->first.c_str();
+    symbols.push_back(symbol);
+  }
+
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr) {
+    int lhs = symbolIndex(curr->first);
+    if (lhs == kWord) continue;
+    for (Definition::const_iterator prod = curr->second.begin(); prod != curr->second.end(); ++prod) {
+      Rule rule;
+      for (Production::const_iterator item = prod->begin(); item != prod->end(); ++item) {
+        rule.symbols.push_back(Production::isNonterminal(*item) ? symbolIndex(*item) : kWord);
+        rule.words.push_back(*item);
+      }
+      symbols[lhs].rules.push_back(rules.size());
+      rules.push_back(rule);
+    }
+  }
+
+  computeMinimumLengths();
+  computeEmptyCycles();
+  counts.assign(symbols.size(), vector<BigInt>(maxLength + 1));
+  states.assign(symbols.size(), vector<State>(maxLength + 1, kUnknown));
+  suffixCounts.resize(rules.size());
+  suffixKnown.resize(rules.size());
+  for (size_t r = 0; r < rules.size(); r++) {
+    suffixCounts[r].assign(rules[r].symbols.size() + 1, vector<BigInt>(maxLength + 1));
+    suffixKnown[r].assign(rules[r].symbols.size() + 1, vector<bool>(maxLength + 1, false));
+  }
+}
+
+int Enumerator::symbolIndex(const string& name) const
+{
+  map<string, int>::const_iterator found = indices.find(name);
+  return found == indices.end() ? kWord : found->second;
+}
+
+/**
+ * Method: computeMinimumLengths
+ * -----------------------------
+ * Bellman-Ford style relaxation, as in GrammarAnalysis, except that
+ * every item that isn't a productive nonterminal counts as one word,
+ * just as it does when counting.  Lengths are capped at maxLength + 1,
+ * since anything longer can't fit in any sentence being counted.
+ */
+
+void Enumerator::computeMinimumLengths()
+{
+  int tooLong = maxLength + 1;
+  minLengths.assign(symbols.size(), tooLong);
+  minSuffixLengths.resize(rules.size());
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t s = 0; s < symbols.size(); s++) {
+      for (size_t i = 0; i < symbols[s].rules.size(); i++) {
+        const Rule& rule = rules[symbols[s].rules[i]];
+        int length = 0;
+        for (size_t j = 0; j < rule.symbols.size(); j++)
+          length = min(tooLong, length + (rule.symbols[j] == kWord ? 1 : minLengths[rule.symbols[j]]));
+        if (length < minLengths[s]) {
+          minLengths[s] = length;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  for (size_t r = 0; r < rules.size(); r++) {
+    const vector<int>& items = rules[r].symbols;
+    minSuffixLengths[r].assign(items.size() + 1, 0);
+    for (int j = items.size() - 1; j >= 0; j--) {
+      int item = (items[j] == kWord) ? 1 : minLengths[items[j]];
+      minSuffixLengths[r][j] = min(tooLong, minSuffixLengths[r][j + 1] + item);
+    }
+  }
+}
+
+/**
+ * Method: computeEmptyCycles
+ * --------------------------
+ * A nonterminal derives another without producing any terminals when
+ * some Production of the first mentions the second and every other
+ * item of that Production can produce nothing.  Every cycle of those
+ * steps is a cycle that can be gone around forever.
+ */
+
+void Enumerator::computeEmptyCycles()
+{
+  vector<vector<int> > successors(symbols.size());
+  for (size_t s = 0; s < symbols.size(); s++) {
+    for (size_t i = 0; i < symbols[s].rules.size(); i++) {
+      const vector<int>& items = rules[symbols[s].rules[i]].symbols;
+      int numNonEmpty = 0, nonEmpty = -1;
+      for (size_t j = 0; j < items.size(); j++) {
+        if (items[j] == kWord || minLengths[items[j]] > 0) {
+          numNonEmpty++;
+          nonEmpty = j;
+        }
+      }
+      for (size_t j = 0; j < items.size(); j++) {
+        if (items[j] != kWord && (numNonEmpty == 0 || (numNonEmpty == 1 && nonEmpty == (int) j)))
+          successors[s].push_back(items[j]);
+      }
+    }
+  }
+
+  onEmptyCycle.assign(symbols.size(), false);
+  vector<vector<int> > cycles = GrammarAnalysis::findCycles(successors);
+  for (size_t c = 0; c < cycles.size(); c++) {
+    for (size_t i = 0; i < cycles[c].size(); i++) onEmptyCycle[cycles[c][i]] = true;
+  }
+}
+
+/**
+ * Method: maxSplit
+ * ----------------
+ * Returns the most terminals the item at the specified position can
+ * produce when the rest of the Production, from that position on, is
+ * to produce exactly length of them.
+ */
+
+int Enumerator::maxSplit(int rule, int position, int length) const
+{
+  return length - minSuffixLengths[rule][position + 1];
+}
+
+BigInt Enumerator::countSentences(const string& nonterminal, int length)
+{
+  assert(length >= 0 && length <= maxLength);
+  int symbol = symbolIndex(nonterminal);
+  if (symbol == kWord) return length == 1 ? one : zero;
+  return count(symbol, length);
+}
+
+BigInt Enumerator::countSentences(const string& nonterminal)
+{
+  BigInt total;
+  for (int length = 0; length <= maxLength; length++) total += countSentences(nonterminal, length);
+  return total;
+}
+
+/**
+ * Method: count
+ * -------------
+ * Returns the number of derivations of the symbol producing exactly
+ * length terminals.  A count that's already being computed further up
+ * the call chain can only be asked for again around an empty cycle,
+ * and going around it adds no new derivations of the ones that don't.
+ * A symbol on such a cycle with any derivations at all has infinitely
+ * many, which is recorded as a cycle.
+ */
+
+const BigInt& Enumerator::count(int symbol, int length)
+{
+  if (states[symbol][length] == kKnown) return counts[symbol][length];
+  if (states[symbol][length] == kComputing) {
+    assert(onEmptyCycle[symbol]);
+    return zero;
+  }
+
+  states[symbol][length] = kComputing;
+  BigInt total;
+  const vector<int>& ruleList = symbols[symbol].rules;
+  for (size_t i = 0; i < ruleList.size(); i++) total += countSuffix(ruleList[i], 0, length);
+  if (onEmptyCycle[symbol] && !total.isZero() && cycle.empty()) cycle = symbols[symbol].name;
+  counts[symbol][length] = total;
+  states[symbol][length] = kKnown;
+  return counts[symbol][length];
+}
+
+const BigInt& Enumerator::countItem(int rule, int position, int length)
+{
+  int symbol = rules[rule].symbols[position];
+  if (symbol == kWord) return length == 1 ? one : zero;
+  return count(symbol, length);
+}
+
+const BigInt& Enumerator::countSuffix(int rule, int position, int length)
+{
+  if (position == (int) rules[rule].symbols.size()) return length == 0 ? one : zero;
+  if (suffixKnown[rule][position][length]) return suffixCounts[rule][position][length];
+
+  BigInt total;
+  if (rules[rule].symbols[position] == kWord) {
+    if (length > 0) total = countSuffix(rule, position + 1, length - 1);
+  } else {
+    for (int split = 0; split <= maxSplit(rule, position, length); split++) {
+      const BigInt& first = countItem(rule, position, split);
+      if (first.isZero()) continue;
+      const BigInt& rest = countSuffix(rule, position + 1, length - split);
+      if (!rest.isZero()) total += first * rest;
+    }
+  }
+  suffixCounts[rule][position][length] = total;
+  suffixKnown[rule][position][length] = true;
+  return suffixCounts[rule][position][length];
+}
+
+void Enumerator::enumerate(const string& nonterminal, const function<void(const vector<const char *>&)>& visit)
+{
+  vector<const char *> sentence;
+  int symbol = symbolIndex(nonterminal);
+  if (symbol == kWord) {
+    sentence.push_back(nonterminal.c_str());
+    if (maxLength >= 1) visit(sentence);
+    return;
+  }
+
+  for (int length = 0; length <= maxLength; length++) {
+    if (count(symbol, length).isZero()) continue;
+    enumerateSymbol(symbol, length, sentence, [&]() { visit(sentence); });
+  }
+}
+
+/**
+ * Methods: enumerateSymbol, enumerateSuffix
+ * -----------------------------------------
+ * Append each derivation in turn to the sentence, calling next
+ * (which carries on with whatever follows) after each one is in
+ * place, and then take it back off.
+ */
+
+void Enumerator::enumerateSymbol(int symbol, int length, vector<const char *>& sentence,
+                                 const function<void()>& next)
+{
+  const vector<int>& ruleList = symbols[symbol].rules;
+  for (size_t i = 0; i < ruleList.size(); i++) {
+    if (!countSuffix(ruleList[i], 0, length).isZero()) enumerateSuffix(ruleList[i], 0, length, sentence, next);
+  }
+}
+
+void Enumerator::enumerateSuffix(int rule, int position, int length, vector<const char *>& sentence,
+                                 const function<void()>& next)
+{
+  const Rule& r = rules[rule];
+  if (position == (int) r.symbols.size()) {
+    next();
+    return;
+  }
+
+  if (r.symbols[position] == kWord) {
+    sentence.push_back(r.words[position]);
+    enumerateSuffix(rule, position + 1, length - 1, sentence, next);
+    sentence.pop_back();
+    return;
+  }
+
+  for (int split = 0; split <= maxSplit(rule, position, length); split++) {
+    if (countItem(rule, position, split).isZero() || countSuffix(rule, position + 1, length - split).isZero()) continue;
+    enumerateSymbol(r.symbols[position], split, sentence, [&]() {
+      enumerateSuffix(rule, position + 1, length - split, sentence, next);
+    });
+  }
+}
+
+/**
+ * Method: sample
+ * --------------
+ * Draws a position among all of the derivations, and then locates it
+ * by peeling off whole lengths, whole Productions, and whole splits
+ * until it's pinned down to a single derivation.
+ */
+
+bool Enumerator::sample(const string& nonterminal, RandomGenerator& random, vector<const char *>& sentence)
+{
+  int symbol = symbolIndex(nonterminal);
+  if (symbol == kWord) return false;
+  BigInt total = countSentences(nonterminal);
+  if (total.isZero()) return false;
+
+  BigInt position = BigInt::getRandomBelow(total, random);
+  for (int length = 0; length <= maxLength; length++) {
+    const BigInt& current = count(symbol, length);
+    if (position < current) {
+      sampleSymbol(symbol, length, random, sentence);
+      return true;
+    }
+    position -= current;
+  }
+  assert(false);
+  return false;
+}
+
+void Enumerator::sampleSymbol(int symbol, int length, RandomGenerator& random, vector<const char *>& sentence)
+{
+  BigInt position = BigInt::getRandomBelow(count(symbol, length), random);
+  const vector<int>& ruleList = symbols[symbol].rules;
+  for (size_t i = 0; i < ruleList.size(); i++) {
+    const BigInt& current = countSuffix(ruleList[i], 0, length);
+    if (position < current) {
+      sampleSuffix(ruleList[i], 0, length, random, sentence);
+      return;
+    }
+    position -= current;
+  }
+  assert(false);
+}
+
+void Enumerator::sampleSuffix(int rule, int position, int length, RandomGenerator& random,
+                              vector<const char *>& sentence)
+{
+  const Rule& r = rules[rule];
+  for (; position < (int) r.symbols.size() && r.symbols[position] == kWord; position++, length--) {
+    sentence.push_back(r.words[position]);
+  }
+  if (position == (int) r.symbols.size()) return;
+
+  BigInt choice = BigInt::getRandomBelow(countSuffix(rule, position, length), random);
+  for (int split = 0; split <= maxSplit(rule, position, length); split++) {
+    BigInt current = countItem(rule, position, split) * countSuffix(rule, position + 1, length - split);
+    if (choice < current) {
+      sampleSymbol(r.symbols[position], split, random, sentence);
+      sampleSuffix(rule, position + 1, length - split, random, sentence);
+      return;
+    }
+    choice -= current;
+  }
+  assert(false);
+}
@@ -0,0 +1,148 @@
+#ifndef __enumerator__
+#define __enumerator__
+
+/**
+ * File: enumerator.h
+ * ------------------
+ * Defines the Enumerator class, which works with every sentence a
+ * grammar can generate (up to some length) rather than with random
+ * samples: it counts them, lists them, and draws from them uniformly.
+ *
+ * Everything rests on a single table: the number of derivations of
+ * each nonterminal that produce exactly n terminals, for every n up
+ * to the length bound.  The table is filled in on demand by dynamic
+ * programming over the productions, using BigInts because the counts
+ * grow exponentially with n.  Terminals, undefined nonterminals and
+ * nonterminals that can never finish expanding are each treated as
+ * a single word, which is how the Expander prints them.
+ *
+ * What's counted are derivations.  A grammar that can derive the
+ * same sentence in two different ways counts (and lists) it twice.
+ * A grammar in which some nonterminal can derive itself without
+ * producing any terminals along the way has infinitely many
+ * derivations of some lengths; that's detected and reported instead.
+ */
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "bigint.h"
+#include "definition.h"
+#include "grammaranalysis.h"
+#include "random.h"
+using namespace std;
+
+class Enumerator {
+
+ public:
+
+  /**
+   * Constructor: Enumerator
+   * -----------------------
+   * Prepares to count sentences of up to maxLength terminals.
+   * Nothing is counted until it's asked for.  The grammar and
+   * the analysis must both outlive the Enumerator.
+   */
+
+  Enumerator(const map<string, Definition>& grammar, const GrammarAnalysis& analysis, int maxLength);
+
+  /**
+   * Method: countSentences
+   * ----------------------
+   * Returns the number of derivations of the named nonterminal that
+   * produce exactly length terminals.  A name that isn't defined is
+   * just a word, so it has one derivation of length 1.
+   */
+
+  BigInt countSentences(const string& nonterminal, int length);
+
+  /**
+   * Method: countSentences
+   * ----------------------
+   * Returns the number of derivations of the named nonterminal that
+   * produce at most maxLength terminals.
+   */
+
+  BigInt countSentences(const string& nonterminal);
+
+  /**
+   * Method: findCycle
+   * -----------------
+   * Returns the name of a nonterminal that can derive itself without
+   * producing any terminals and was found to have derivations of some
+   * length counted so far, or the empty string if there's no such
+   * nonterminal.  Such a nonterminal has infinitely many derivations
+   * of that length, so counts computed after it was found are
+   * meaningless.  Left recursion that produces a terminal on the way
+   * round, as in <list> -> <list> a, is no such cycle.
+   */
+
+  const string& findCycle() const { return cycle; }
+
+  /**
+   * Method: enumerate
+   * -----------------
+   * Calls visit once for every derivation of the named nonterminal
+   * with at most maxLength terminals, shortest sentences first.
+   * The sentence passed to visit is only valid during the call.
+   */
+
+  void enumerate(const string& nonterminal, const function<void(const vector<const char *>&)>& visit);
+
+  /**
+   * Method: sample
+   * --------------
+   * Appends a sentence drawn uniformly at random from all of the
+   * derivations of the named nonterminal with at most maxLength
+   * terminals.
+   *
+   * @return false (and appends nothing) if there aren't any.
+   */
+
+  bool sample(const string& nonterminal, RandomGenerator& random, vector<const char *>& sentence);
+
+ private:
+  static const int kWord = -1;
+
+  struct Rule {
+    vector<int> symbols;          // a symbol index, or kWord for a single word
+    vector<const char *> words;
+  };
+
+  struct Symbol {
+    const char *name;
+    vector<int> rules;
+  };
+
+  enum State { kUnknown, kComputing, kKnown };
+
+  int symbolIndex(const string& name) const;
+  void computeMinimumLengths();
+  void computeEmptyCycles();
+  int maxSplit(int rule, int position, int length) const;
+  const BigInt& count(int symbol, int length);
+  const BigInt& countSuffix(int rule, int position, int length);
+  const BigInt& countItem(int rule, int position, int length);
+  void enumerateSymbol(int symbol, int length, vector<const char *>& sentence, const function<void()>& next);
+  void enumerateSuffix(int rule, int position, int length, vector<const char *>& sentence,
+                       const function<void()>& next);
+  void sampleSymbol(int symbol, int length, RandomGenerator& random, vector<const char *>& sentence);
+  void sampleSuffix(int rule, int position, int length, RandomGenerator& random, vector<const char *>& sentence);
+
+  int maxLength;
+  string cycle;
+  vector<Symbol> symbols;
+  vector<Rule> rules;
+  vector<int> minLengths;                     // indexed by symbol, capped at maxLength + 1
+  vector<vector<int> > minSuffixLengths;      // indexed by rule, then position
+  vector<bool> onEmptyCycle;
+  map<string, int> indices;
+  vector<vector<BigInt> > counts;             // indexed by symbol, then length
+  vector<vector<State> > states;
+  vector<vector<vector<BigInt> > > suffixCounts;   // indexed by rule, position, then length
+  vector<vector<vector<bool> > > suffixKnown;
+  BigInt zero, one;
+};
+
+#endif // ! __enumerator__
@@ -0,0 +1,155 @@
+/**
+ * File: expander.cc
+ * -----------------
+ * Provides the implementation of the Expander class.
+ *
+ * The token budget is enforced by keeping track of how many terminals
+ * the sentence is already committed to: those emitted so far, plus the
+ * minimum lengths of every nonterminal still waiting to be expanded.
+ * A Production is only chosen at random if swapping the nonterminal's
+ * minimum length for the Production's minimum length keeps that total
+ * within the budget.  Otherwise the shortest Production is used, which
+ * leaves the total unchanged.
+ */
+
+#include "expander.h"
+#include <climits>
+using namespace std;
+
+static const long kUnboundedLength = LONG_MAX / 4;
+
+/**
+ * Constructor: Expander
+ * ---------------------
+ * Builds an Entry for every productive Definition, holding the minimum
+ * length of each of its Productions so that checking the token budget
+ * doesn't have to look anything up in the middle of an expansion.  Then
+ * maps every nonterminal item appearing in any Production to its Entry.
+ * Items are interned, so that's one Entry lookup per distinct nonterminal.
+ * Items left unmapped (terminals, and undefined or unproductive
+ * nonterminals) are always appended verbatim.
+ */
+
+Expander::Expander(const map<string, Definition>& grammar, const GrammarAnalysis& analysis,
+                   RandomGenerator& random)
+  : analysis(analysis), random(random), maxDepth(0), maxTokens(0), committed(0),
+    emitted(0), profiler(NULL)
+{
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr) {
+    if (!analysis.isProductive(curr->first)) continue;
+    Entry& entry = entries[curr->first];
+    entry.name = curr->first.c_str();
+    entry.definition = &curr->second;
+    entry.minLength = analysis.getMinimumLength(curr->first);
+    entry.shortest = analysis.getShortestProduction(curr->first);
+    for (Definition::const_iterator prod = curr->second.begin(); prod != curr->second.end(); ++prod) {
+      long length = 0;
+      for (Production::const_iterator item = prod->begin(); item != prod->end(); ++item) {
+        long itemLength = Production::isNonterminal(*item) ? analysis.getMinimumLength(*item) : 1;
+        length = (itemLength == -1 || length == kUnboundedLength) ? kUnboundedLength : length + itemLength;
+      }
+      entry.productionLengths.push_back(length);
+    }
+  }
+
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr) {
+    for (Definition::const_iterator prod = curr->second.begin(); prod != curr->second.end(); ++prod) {
+      for (Production::const_iterator item = prod->begin(); item != prod->end(); ++item) {
+        if (entriesByItem.count(*item) > 0 || !Production::isNonterminal(*item)) continue;
+        map<string, Entry>::const_iterator found = entries.find(*item);
+        if (found != entries.end()) entriesByItem[*item] = &found->second;
+      }
+    }
+  }
+}
+
+void Expander::setLimits(int maxDepth, long maxTokens)
+{
+  this->maxDepth = maxDepth;
+  this->maxTokens = maxTokens;
+}
+
+/**
+ * Functions: emit
+ * ---------------
+ * Hand a terminal to whichever kind of sink the sentence is being
+ * built in, so the expansion itself only has to be written once.
+ */
+
+static void emit(vector<const char *>& sentence, const char *item)
+{
+  sentence.push_back(item);
+}
+
+static void emit(SentenceWriter& writer, const char *item)
+{
+  writer.write(item);
+}
+
+void Expander::expand(const char *nonterminal, vector<const char *>& sentence)
+{
+  expand<vector<const char *> >(nonterminal, sentence);
+}
+
+void Expander::expand(const char *nonterminal, SentenceWriter& writer)
+{
+  expand<SentenceWriter>(nonterminal, writer);
+}
+
+/**
+ * Method: expand
+ * --------------
+ * Looks up the start symbol by name, which is the only string
+ * lookup made per sentence.
+ */
+
+template <typename Sink>
+void Expander::expand(const char *nonterminal, Sink& sink)
+{
+  map<string, Entry>::const_iterator found = entries.find(nonterminal);
+  if (found == entries.end()) {
+    emit(sink, nonterminal);
+    emitted++;
+    return;
+  }
+
+  committed = found->second.minLength;
+  expand(found->second, 1, sink);
+}
+
+/**
+ * Method: expand
+ * --------------
+ * Chooses a Production for the specified nonterminal (falling back to
+ * the shortest one once a budget runs out) and expands its items from
+ * left to right, recurring on each nonterminal.
+ */
+
+template <typename Sink>
+void Expander::expand(const Entry& entry, int depth, Sink& sink)
+{
+  if (profiler != NULL) profiler->enter(entry.name, depth, emitted);
+  const Definition& def = *entry.definition;
+  const Production *chosen = &def.getRandomProduction(random);
+  if (maxDepth > 0 || maxTokens > 0) {
+    long growth = entry.productionLengths[chosen - &def.getProduction(0)] - entry.minLength;
+    bool tooDeep = maxDepth > 0 && depth >= maxDepth;
+    bool tooLong = maxTokens > 0 && committed + growth > maxTokens;
+    if (tooDeep || tooLong) {
+      chosen = &def.getProduction(entry.shortest);
+      growth = 0;
+    }
+    committed += growth;
+  }
+
+  for (Production::const_iterator item = chosen->begin(); item != chosen->end(); ++item) {
+    unordered_map<const char *, const Entry *>::const_iterator found = entriesByItem.find(*item);
+    if (found != entriesByItem.end()) {
+      expand(*found->second, depth + 1, sink);
+    } else {
+      emit(sink, *item);
+      emitted++;
+    }
+  }
+  if (profiler != NULL) profiler->exit(emitted);
+}
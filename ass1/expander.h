@@ -0,0 +1,123 @@
+#ifndef __expander__
+#define __expander__
+
+/**
+ * File: expander.h
+ * ----------------
+ * Defines the Expander class, which turns a nonterminal into a random
+ * sentence by recursively expanding it, leftmost nonterminal first.
+ *
+ * An Expander can optionally be given a depth budget and a token budget.
+ * While both budgets hold, Productions are chosen at random as usual.
+ * Once choosing at random would nest nonterminals deeper than the depth
+ * budget, or would commit the sentence to more terminals than the token
+ * budget allows, the Expander switches to each nonterminal's shortest
+ * Production instead.  Shortest expansions always terminate, so every
+ * sentence is finite, and no sentence is ever longer than the token
+ * budget (or the grammar's own minimum, if that happens to be longer).
+ *
+ * Sentences are built out of pointers to the grammar's own interned
+ * items, and every nonterminal item is resolved to its Definition
+ * up front, so expanding never copies a string or a Production and
+ * never compares strings.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "definition.h"
+#include "grammaranalysis.h"
+#include "random.h"
+#include "sentencewriter.h"
+#include "profiler.h"
+using namespace std;
+
+class Expander {
+
+ public:
+
+  /**
+   * Constructor: Expander
+   * ---------------------
+   * Constructs an unbounded Expander over the specified grammar.  The
+   * grammar, the analysis and the generator must all outlive the Expander.
+   *
+   * @param grammar the grammar being expanded.
+   * @param analysis an analysis of that same grammar, which supplies
+   *                 the shortest expansions used once a budget runs out.
+   * @param random the generator used to choose among Productions.
+   */
+
+  Expander(const map<string, Definition>& grammar, const GrammarAnalysis& analysis,
+           RandomGenerator& random);
+
+  /**
+   * Method: setLimits
+   * -----------------
+   * Installs the depth and token budgets applied to every subsequent
+   * call to expand.  A budget of 0 means no budget at all.  The start
+   * symbol itself sits at depth 1.
+   */
+
+  void setLimits(int maxDepth, long maxTokens);
+
+  /**
+   * Method: setProfiler
+   * -------------------
+   * Reports every subsequent expansion of a nonterminal to the
+   * specified Profiler, or to no Profiler at all if it's NULL
+   * (which is the default).  The Profiler must outlive the Expander.
+   */
+
+  void setProfiler(Profiler *profiler) { this->profiler = profiler; }
+
+  /**
+   * Method: expand
+   * --------------
+   * Appends a random expansion of the specified nonterminal to the
+   * sentence.  Nonterminals that are undefined, or that can never
+   * finish expanding, are appended as is rather than expanded.  The
+   * appended strings belong to the grammar (or, if the start symbol
+   * itself can't be expanded, are the start symbol), and are only
+   * valid for as long as those are.
+   */
+
+  void expand(const char *nonterminal, vector<const char *>& sentence);
+
+  /**
+   * Method: expand
+   * --------------
+   * Operates exactly like the version above, except that every
+   * terminal is written straight to the SentenceWriter the moment
+   * it's chosen, rather than collected first.
+   */
+
+  void expand(const char *nonterminal, SentenceWriter& writer);
+
+ private:
+  struct Entry {
+    const char *name;
+    const Definition *definition;
+    long minLength;
+    int shortest;
+    vector<long> productionLengths;
+  };
+
+  Expander(const Expander& other) = delete;
+  Expander& operator=(const Expander& other) = delete;
+  template <typename Sink> void expand(const char *nonterminal, Sink& sink);
+  template <typename Sink> void expand(const Entry& entry, int depth, Sink& sink);
+
+  const GrammarAnalysis& analysis;
+  RandomGenerator& random;
+  map<string, Entry> entries;
+  unordered_map<const char *, const Entry *> entriesByItem;
+  int maxDepth;
+  long maxTokens;
+  long committed;
+  long emitted;
+  Profiler *profiler;
+};
+
+#endif // ! __expander__
@@ -0,0 +1,443 @@
+/**
+ * File: grammaranalysis.cc
+ * ------------------------
+ * Provides the implementation of the GrammarAnalysis class.  The grammar
+ * is first flattened into a list of rules, each of which records its
+ * left-hand side, its probability of being chosen, how many terminals it
+ * contains, and which nonterminals it contains.  Every property is then
+ * computed by iterating over those rules until nothing changes.
+ */
+
+#include "grammaranalysis.h"
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <iomanip>
+using namespace std;
+
+static const long kInfiniteLength = LONG_MAX;
+static const int kUnboundedDepth = -1;
+static const int kUnknownDepth = -2;
+static const int kMaxExpectedLengthRounds = 100000;
+static const double kConvergenceTolerance = 1e-12;
+static const double kDivergenceThreshold = 1e15;
+
+GrammarAnalysis::GrammarAnalysis(const map<string, Definition>& grammar, const string& startSymbol)
+{
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr) {
+    symbols[symbolIndex(curr->first)].defined = true;
+  }
+
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr) {
+    double totalWeight = 0;
+    for (Definition::const_iterator prod = curr->second.begin(); prod != curr->second.end(); ++prod)
+      totalWeight += prod->getWeight();
+    for (Definition::const_iterator prod = curr->second.begin(); prod != curr->second.end(); ++prod) {
+      Rule rule;
+      rule.lhs = lookup(curr->first);
+      rule.position = prod - curr->second.begin();
+      rule.probability = prod->getWeight() / totalWeight;
+      rule.numTerminals = 0;
+      for (Production::const_iterator item = prod->begin(); item != prod->end(); ++item) {
+        if (Production::isNonterminal(*item)) rule.nonterminals.push_back(symbolIndex(*item));
+        else rule.numTerminals++;
+      }
+      rules.push_back(rule);
+    }
+  }
+
+  start = symbolIndex(startSymbol);
+  rulesBySymbol.resize(symbols.size());
+  for (size_t r = 0; r < rules.size(); r++) rulesBySymbol[rules[r].lhs].push_back(r);
+
+  computeReachable();
+  computeProductive();
+  computeMinimumLengths();
+  computeExpectedLengths();
+  computeCycles();
+  computeMaximumDepths();
+}
+
+/**
+ * Method: symbolIndex
+ * -------------------
+ * Returns the index of the named nonterminal, adding a fresh
+ * (undefined, so far) entry for it if it hasn't been seen yet.
+ */
+
+int GrammarAnalysis::symbolIndex(const string& name)
+{
+  map<string, int>::const_iterator found = indices.find(name);
+  if (found != indices.end()) return found->second;
+  Symbol symbol;
+  symbol.name = name;
+  symbol.defined = symbol.reachable = symbol.productive = symbol.recursive = false;
+  symbol.minLength = kInfiniteLength;
+  symbol.shortestRule = -1;
+  symbol.expectedLength = 0;
+  symbol.maxDepth = kUnknownDepth;
+  symbols.push_back(symbol);
+  return indices[name] = symbols.size() - 1;
+}
+
+int GrammarAnalysis::lookup(const string& name) const
+{
+  map<string, int>::const_iterator found = indices.find(name);
+  return (found == indices.end()) ? -1 : found->second;
+}
+
+/**
+ * Method: computeReachable
+ * ------------------------
+ * Plain worklist traversal of the production graph out of the start symbol.
+ */
+
+void GrammarAnalysis::computeReachable()
+{
+  vector<int> worklist(1, start);
+  symbols[start].reachable = true;
+  while (!worklist.empty()) {
+    int symbol = worklist.back();
+    worklist.pop_back();
+    for (size_t r = 0; r < rulesBySymbol[symbol].size(); r++) {
+      const Rule& rule = rules[rulesBySymbol[symbol][r]];
+      for (size_t i = 0; i < rule.nonterminals.size(); i++) {
+        Symbol& next = symbols[rule.nonterminals[i]];
+        if (!next.reachable) {
+          next.reachable = true;
+          worklist.push_back(rule.nonterminals[i]);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Method: computeProductive
+ * -------------------------
+ * A nonterminal is productive once one of its rules mentions nothing
+ * but terminals and productive nonterminals.  Starts with nothing
+ * productive and sweeps the rules until a sweep changes nothing.
+ */
+
+void GrammarAnalysis::computeProductive()
+{
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t r = 0; r < rules.size(); r++) {
+      const Rule& rule = rules[r];
+      if (symbols[rule.lhs].productive) continue;
+      bool productive = true;
+      for (size_t i = 0; productive && i < rule.nonterminals.size(); i++)
+        productive = symbols[rule.nonterminals[i]].productive;
+      if (productive) {
+        symbols[rule.lhs].productive = true;
+        changed = true;
+      }
+    }
+  }
+}
+
+/**
+ * Method: computeMinimumLengths
+ * -----------------------------
+ * Bellman-Ford style relaxation: a rule's length is its terminal count
+ * plus the current minimum lengths of its nonterminals, and a symbol's
+ * minimum length only ever shrinks, so the sweeps eventually stop.
+ * Because a symbol's shortest rule is only replaced by a strictly
+ * shorter one, following shortest rules can never lead in a circle.
+ */
+
+void GrammarAnalysis::computeMinimumLengths()
+{
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t r = 0; r < rules.size(); r++) {
+      const Rule& rule = rules[r];
+      long length = rule.numTerminals;
+      for (size_t i = 0; length != kInfiniteLength && i < rule.nonterminals.size(); i++) {
+        long child = symbols[rule.nonterminals[i]].minLength;
+        length = (child == kInfiniteLength) ? kInfiniteLength : length + child;
+      }
+      if (length < symbols[rule.lhs].minLength) {
+        symbols[rule.lhs].minLength = length;
+        symbols[rule.lhs].shortestRule = r;
+        changed = true;
+      }
+    }
+  }
+}
+
+/**
+ * Method: computeExpectedLengths
+ * ------------------------------
+ * The expected lengths satisfy E[X] = sum over X's rules of
+ * p * (terminals + sum of E[Y] for each nonterminal Y in the rule).
+ * Iterating that equation from all zeroes climbs monotonically toward
+ * its least solution; when the climb doesn't settle (the grammar
+ * recurses at least as often as it terminates), the expectation is
+ * unbounded.  Unproductive nonterminals are unbounded by definition.
+ */
+
+void GrammarAnalysis::computeExpectedLengths()
+{
+  vector<double> current(symbols.size(), 0.0), next(symbols.size());
+  vector<bool> settled(symbols.size(), false);
+  for (int round = 0; round < kMaxExpectedLengthRounds; round++) {
+    fill(next.begin(), next.end(), 0.0);
+    for (size_t r = 0; r < rules.size(); r++) {
+      const Rule& rule = rules[r];
+      double length = rule.numTerminals;
+      for (size_t i = 0; i < rule.nonterminals.size(); i++) length += current[rule.nonterminals[i]];
+      next[rule.lhs] += rule.probability * length;
+    }
+
+    bool converged = true, diverged = false;
+    for (size_t s = 0; s < symbols.size(); s++) {
+      if (!symbols[s].productive) {
+        next[s] = 0;   // unbounded regardless; see below
+        continue;
+      }
+      settled[s] = fabs(next[s] - current[s]) <= kConvergenceTolerance * max(1.0, next[s]);
+      converged = converged && settled[s];
+      diverged = diverged || next[s] > kDivergenceThreshold;
+    }
+    current.swap(next);
+    if (converged || diverged) break;
+  }
+
+  for (size_t s = 0; s < symbols.size(); s++) {
+    bool bounded = symbols[s].productive && settled[s] && current[s] <= kDivergenceThreshold;
+    symbols[s].expectedLength = bounded ? current[s] : HUGE_VAL;
+  }
+
+  // a rule that can lead into an unbounded expansion makes its own
+  // left-hand side unbounded as well, even if the iteration above
+  // happened to settle it
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t r = 0; r < rules.size(); r++) {
+      const Rule& rule = rules[r];
+      if (symbols[rule.lhs].expectedLength == HUGE_VAL) continue;
+      for (size_t i = 0; i < rule.nonterminals.size(); i++) {
+        if (symbols[rule.nonterminals[i]].expectedLength == HUGE_VAL) {
+          symbols[rule.lhs].expectedLength = HUGE_VAL;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Method: computeCycles
+ * ---------------------
+ * Every cycle in the graph of which nonterminals mention which is a
+ * recursive cycle.
+ */
+
+void GrammarAnalysis::computeCycles()
+{
+  vector<vector<int> > successors(symbols.size());
+  for (size_t r = 0; r < rules.size(); r++) {
+    for (size_t i = 0; i < rules[r].nonterminals.size(); i++)
+      successors[rules[r].lhs].push_back(rules[r].nonterminals[i]);
+  }
+
+  cycles = findCycles(successors);
+  for (size_t c = 0; c < cycles.size(); c++) {
+    for (size_t i = 0; i < cycles[c].size(); i++) symbols[cycles[c][i]].recursive = true;
+  }
+}
+
+/**
+ * Static Method: findCycles
+ * -------------------------
+ * Tarjan's strongly connected components algorithm, written with an
+ * explicit stack so that long chains of nonterminals can't overflow the
+ * call stack.
+ */
+
+vector<vector<int> > GrammarAnalysis::findCycles(const vector<vector<int> >& successors)
+{
+  int n = successors.size();
+  vector<int> index(n, -1), lowlink(n, 0), stack;
+  vector<bool> onStack(n, false);
+  vector<vector<int> > cycles;
+
+  int counter = 0;
+  for (int root = 0; root < n; root++) {
+    if (index[root] != -1) continue;
+    vector<pair<int, size_t> > frames(1, make_pair(root, (size_t) 0));
+    index[root] = lowlink[root] = counter++;
+    stack.push_back(root);
+    onStack[root] = true;
+    while (!frames.empty()) {
+      int v = frames.back().first;
+      size_t& edge = frames.back().second;
+      if (edge < successors[v].size()) {
+        int w = successors[v][edge++];
+        if (index[w] == -1) {
+          index[w] = lowlink[w] = counter++;
+          stack.push_back(w);
+          onStack[w] = true;
+          frames.push_back(make_pair(w, (size_t) 0));
+        } else if (onStack[w]) {
+          lowlink[v] = min(lowlink[v], index[w]);
+        }
+        continue;
+      }
+
+      if (lowlink[v] == index[v]) {
+        vector<int> component;
+        int w;
+        do {
+          w = stack.back();
+          stack.pop_back();
+          onStack[w] = false;
+          component.push_back(w);
+        } while (w != v);
+        bool selfLoop = find(successors[v].begin(), successors[v].end(), v) != successors[v].end();
+        if (component.size() > 1 || selfLoop) {
+          sort(component.begin(), component.end());
+          cycles.push_back(component);
+        }
+      }
+      frames.pop_back();
+      if (!frames.empty()) lowlink[frames.back().first] = min(lowlink[frames.back().first], lowlink[v]);
+    }
+  }
+  return cycles;
+}
+
+void GrammarAnalysis::computeMaximumDepths()
+{
+  for (size_t s = 0; s < symbols.size(); s++) computeMaximumDepth(s);
+}
+
+/**
+ * Method: computeMaximumDepth
+ * ---------------------------
+ * Memoized depth-first computation over the (acyclic, once the recursive
+ * symbols have been ruled out) production graph.  Undefined nonterminals
+ * are treated as leaves.
+ */
+
+int GrammarAnalysis::computeMaximumDepth(int symbol)
+{
+  Symbol& sym = symbols[symbol];
+  if (sym.maxDepth != kUnknownDepth) return sym.maxDepth;
+  if (sym.recursive) return sym.maxDepth = kUnboundedDepth;
+  if (!sym.defined) return sym.maxDepth = 0;
+
+  int deepest = 0;
+  for (size_t r = 0; r < rulesBySymbol[symbol].size(); r++) {
+    const Rule& rule = rules[rulesBySymbol[symbol][r]];
+    for (size_t i = 0; i < rule.nonterminals.size(); i++) {
+      int child = computeMaximumDepth(rule.nonterminals[i]);
+      if (child == kUnboundedDepth) return symbols[symbol].maxDepth = kUnboundedDepth;
+      deepest = max(deepest, child);
+    }
+  }
+  return symbols[symbol].maxDepth = deepest + 1;
+}
+
+bool GrammarAnalysis::isReachable(const string& nonterminal) const
+{
+  int symbol = lookup(nonterminal);
+  return symbol != -1 && symbols[symbol].reachable;
+}
+
+bool GrammarAnalysis::isProductive(const string& nonterminal) const
+{
+  int symbol = lookup(nonterminal);
+  return symbol != -1 && symbols[symbol].productive;
+}
+
+long GrammarAnalysis::getMinimumLength(const string& nonterminal) const
+{
+  int symbol = lookup(nonterminal);
+  if (symbol == -1 || symbols[symbol].minLength == kInfiniteLength) return -1;
+  return symbols[symbol].minLength;
+}
+
+int GrammarAnalysis::getShortestProduction(const string& nonterminal) const
+{
+  int symbol = lookup(nonterminal);
+  if (symbol == -1 || symbols[symbol].shortestRule == -1) return -1;
+  return rules[symbols[symbol].shortestRule].position;
+}
+
+double GrammarAnalysis::getExpectedLength(const string& nonterminal) const
+{
+  int symbol = lookup(nonterminal);
+  return (symbol == -1) ? HUGE_VAL : symbols[symbol].expectedLength;
+}
+
+int GrammarAnalysis::getMaximumDepth(const string& nonterminal) const
+{
+  int symbol = lookup(nonterminal);
+  return (symbol == -1) ? kUnboundedDepth : symbols[symbol].maxDepth;
+}
+
+int GrammarAnalysis::printWarnings(ostream& out) const
+{
+  int count = 0;
+  if (!symbols[start].defined) {
+    out << "warning: the start symbol " << symbols[start].name << " is never defined" << endl;
+    return 1;
+  }
+
+  for (size_t s = 0; s < symbols.size(); s++) {
+    const Symbol& sym = symbols[s];
+    if (!sym.defined) {
+      out << "warning: " << sym.name << " is used but never defined" << endl;
+      count++;
+    } else if (!sym.reachable) {
+      out << "warning: " << sym.name << " can't be reached from " << symbols[start].name << endl;
+      count++;
+    } else if (!sym.productive) {
+      out << "warning: " << sym.name << " can never finish expanding" << endl;
+      count++;
+    } else if (sym.expectedLength == HUGE_VAL) {
+      out << "warning: " << sym.name << " has an unbounded expected expansion length" << endl;
+      count++;
+    }
+  }
+  return count;
+}
+
+void GrammarAnalysis::printReport(ostream& out) const
+{
+  if (printWarnings(out) > 0) out << endl;
+
+  out << left << setw(32) << "nonterminal" << right
+      << setw(10) << "reachable" << setw(12) << "productive"
+      << setw(12) << "min length" << setw(16) << "expected length"
+      << setw(11) << "max depth" << endl;
+  for (size_t s = 0; s < symbols.size(); s++) {
+    const Symbol& sym = symbols[s];
+    if (!sym.defined) continue;
+    out << left << setw(32) << sym.name << right
+        << setw(10) << (sym.reachable ? "yes" : "no")
+        << setw(12) << (sym.productive ? "yes" : "no");
+    if (sym.minLength == kInfiniteLength) out << setw(12) << "-";
+    else out << setw(12) << sym.minLength;
+    if (sym.expectedLength == HUGE_VAL) out << setw(16) << "unbounded";
+    else out << setw(16) << fixed << setprecision(2) << sym.expectedLength;
+    if (sym.maxDepth == kUnboundedDepth) out << setw(11) << "unbounded";
+    else out << setw(11) << sym.maxDepth;
+    out << endl;
+  }
+
+  out << endl << cycles.size() << " recursive cycle" << (cycles.size() == 1 ? "" : "s") << (cycles.empty() ? "." : ":") << endl;
+  for (size_t c = 0; c < cycles.size(); c++) {
+    out << "  ";
+    for (size_t i = 0; i < cycles[c].size(); i++) out << (i == 0 ? "" : " ") << symbols[cycles[c][i]].name;
+    out << endl;
+  }
+}
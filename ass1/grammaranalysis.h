@@ -0,0 +1,170 @@
+#ifndef __grammaranalysis__
+#define __grammaranalysis__
+
+/**
+ * File: grammaranalysis.h
+ * -----------------------
+ * Defines the GrammarAnalysis class, which inspects a loaded grammar
+ * before anything is generated from it and reports the nonterminals
+ * that would make generation misbehave: those that are never defined,
+ * those that can never finish expanding, those that can't be reached
+ * from <start>, and those whose expansions are expected to be infinitely
+ * long.  It also reports every recursive cycle and, where it's bounded,
+ * the deepest nesting of nonterminals an expansion can reach.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "definition.h"
+using namespace std;
+
+class GrammarAnalysis {
+
+ public:
+
+  /**
+   * Constructor: GrammarAnalysis
+   * ----------------------------
+   * Analyzes the specified grammar.  Every property is computed up
+   * front, with fixpoint iterations over the production graph, so the
+   * accessors below are all simple lookups.
+   *
+   * @param grammar the fully loaded grammar being analyzed.
+   * @param start the nonterminal generation starts from.
+   */
+
+  GrammarAnalysis(const map<string, Definition>& grammar, const string& start = "<start>");
+
+  /**
+   * Method: isReachable
+   * -------------------
+   * Returns true if and only if the named nonterminal can appear
+   * in some expansion of the start symbol.
+   */
+
+  bool isReachable(const string& nonterminal) const;
+
+  /**
+   * Method: isProductive
+   * --------------------
+   * Returns true if and only if the named nonterminal can expand
+   * into a finite sequence of terminals.  Undefined nonterminals
+   * are never productive.
+   */
+
+  bool isProductive(const string& nonterminal) const;
+
+  /**
+   * Method: getMinimumLength
+   * ------------------------
+   * Returns the smallest number of terminals the named nonterminal
+   * can expand into, or -1 if it isn't productive.
+   */
+
+  long getMinimumLength(const string& nonterminal) const;
+
+  /**
+   * Method: getShortestProduction
+   * -----------------------------
+   * Returns the position (within its Definition) of the Production
+   * that begins a shortest expansion of the named nonterminal, or -1
+   * if it isn't productive.  Repeatedly choosing the shortest Production
+   * is guaranteed to terminate, and to produce exactly getMinimumLength
+   * terminals.
+   */
+
+  int getShortestProduction(const string& nonterminal) const;
+
+  /**
+   * Method: getExpectedLength
+   * -------------------------
+   * Returns the expected number of terminals in a random expansion
+   * of the named nonterminal, taking production weights into account,
+   * or HUGE_VAL if that expectation is unbounded.
+   */
+
+  double getExpectedLength(const string& nonterminal) const;
+
+  /**
+   * Method: getMaximumDepth
+   * -----------------------
+   * Returns the deepest nesting of nonterminals any expansion of the
+   * named nonterminal can reach (a nonterminal whose productions are
+   * all terminals has depth 1), or -1 if recursion leaves it unbounded.
+   */
+
+  int getMaximumDepth(const string& nonterminal) const;
+
+  /**
+   * Method: printWarnings
+   * ---------------------
+   * Prints one line per problem found in the grammar.
+   *
+   * @return the number of warnings printed.
+   */
+
+  int printWarnings(ostream& out) const;
+
+  /**
+   * Method: printReport
+   * -------------------
+   * Prints the full analysis: the warnings, a table with every
+   * nonterminal's properties, and the list of recursive cycles.
+   */
+
+  void printReport(ostream& out) const;
+
+  /**
+   * Static Method: findCycles
+   * -------------------------
+   * Finds the cycles of a directed graph over the nodes 0 through
+   * successors.size() - 1, where successors[v] lists the nodes v has
+   * an edge to.  Every strongly connected component with more than one
+   * node, or with a node that has an edge to itself, is returned as a
+   * cycle, with its nodes in increasing order.
+   */
+
+  static vector<vector<int> > findCycles(const vector<vector<int> >& successors);
+
+ private:
+  struct Symbol {
+    string name;
+    bool defined;
+    bool reachable;
+    bool productive;
+    long minLength;
+    int shortestRule;
+    double expectedLength;
+    int maxDepth;
+    bool recursive;
+  };
+
+  struct Rule {
+    int lhs;
+    int position;
+    double probability;
+    int numTerminals;
+    vector<int> nonterminals;
+  };
+
+  int symbolIndex(const string& name);
+  int lookup(const string& name) const;
+  void computeReachable();
+  void computeProductive();
+  void computeMinimumLengths();
+  void computeExpectedLengths();
+  void computeCycles();
+  void computeMaximumDepths();
+  int computeMaximumDepth(int symbol);
+
+  int start;
+  vector<Symbol> symbols;
+  vector<Rule> rules;
+  vector<vector<int> > rulesBySymbol;
+  vector<vector<int> > cycles;
+  map<string, int> indices;
+};
+
+#endif // ! __grammaranalysis__
@@ -0,0 +1,296 @@
+/**
+ * File: grammarimage.cc
+ * ---------------------
+ * Provides the implementation of the GrammarImage class, which
+ * compiles a loaded grammar into a flat binary image and later
+ * generates sentences directly out of a memory-mapped copy of it.
+ */
+
+#include "grammarimage.h"
+#include <fstream>
+#include <cassert>
+#include <climits>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+static const char kImageMagic[4] = { 'R', 'S', 'G', 'C' };
+static const uint32_t kImageVersion = 2;
+
+/**
+ * Function: internString
+ * ----------------------
+ * Returns the offset of the specified string within the
+ * string pool being built, appending it (and its '\0')
+ * the first time it's seen.
+ */
+
+static uint32_t internString(const string& str, map<string, uint32_t>& offsets, string& pool)
+{
+  map<string, uint32_t>::const_iterator found = offsets.find(str);
+  if (found != offsets.end()) return found->second;
+  uint32_t offset = pool.size();
+  pool.append(str);
+  pool.push_back('\0');
+  offsets[str] = offset;
+  return offset;
+}
+
+/**
+ * Function: symbolIndex
+ * ---------------------
+ * Returns the index of the named nonterminal within the symbol
+ * table being built, creating an empty (undefined) entry for
+ * it the first time it's referenced.
+ */
+
+static uint32_t symbolIndex(const string& name, map<string, uint32_t>& indices, vector<string>& names)
+{
+  map<string, uint32_t>::const_iterator found = indices.find(name);
+  if (found != indices.end()) return found->second;
+  uint32_t index = names.size();
+  names.push_back(name);
+  indices[name] = index;
+  return index;
+}
+
+/**
+ * Function: writeWords
+ * --------------------
+ * Writes the specified vector of 32-bit words to outfile.
+ */
+
+static void writeWords(ofstream& outfile, const vector<uint32_t>& words)
+{
+  if (!words.empty())
+    outfile.write(reinterpret_cast<const char *>(&words[0]), words.size() * sizeof(uint32_t));
+}
+
+/**
+ * Static Method: compile
+ * ----------------------
+ * Lays every definition's productions out back to back, numbering
+ * the defined nonterminals first (in map order) so that each symbol's
+ * productions are contiguous.  Undefined nonterminals are numbered
+ * after that, as they're discovered.
+ */
+
+bool GrammarImage::compile(const map<string, Definition>& grammar, const string& filename)
+{
+  map<string, uint32_t> indices;
+  vector<string> names;
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr)
+    symbolIndex(curr->first, indices, names);
+
+  map<string, uint32_t> offsets;
+  string pool;
+  vector<uint32_t> firstProductions(names.size(), 0), numProductions(names.size(), 0);
+  vector<uint32_t> totalWeights(names.size(), 0);
+  vector<uint32_t> productionOffsets, aliasTable, items;
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr) {
+    uint32_t symbol = indices[curr->first];
+    firstProductions[symbol] = productionOffsets.size();
+    numProductions[symbol] = curr->second.size();
+    if (curr->second.getTotalWeight() > INT_MAX) return false;
+    totalWeights[symbol] = curr->second.getTotalWeight();
+    for (int column = 0; column < curr->second.size(); column++) {
+      aliasTable.push_back(curr->second.getThreshold(column));
+      aliasTable.push_back(curr->second.getAlias(column));
+    }
+    for (Definition::const_iterator prod = curr->second.begin(); prod != curr->second.end(); ++prod) {
+      productionOffsets.push_back(items.size());
+      for (Production::const_iterator item = prod->begin(); item != prod->end(); ++item) {
+        if (Production::isNonterminal(*item)) {
+          items.push_back(kNonterminalBit | symbolIndex(*item, indices, names));
+        } else {
+          items.push_back(internString(*item, offsets, pool));
+        }
+      }
+    }
+  }
+  productionOffsets.push_back(items.size());
+  firstProductions.resize(names.size(), productionOffsets.size() - 1);
+  numProductions.resize(names.size(), 0);
+  totalWeights.resize(names.size(), 0);
+
+  vector<uint32_t> symbolTable;
+  for (size_t i = 0; i < names.size(); i++) {
+    symbolTable.push_back(internString(names[i], offsets, pool));
+    symbolTable.push_back(firstProductions[i]);
+    symbolTable.push_back(numProductions[i]);
+    symbolTable.push_back(totalWeights[i]);
+  }
+
+  Header header;
+  memcpy(header.magic, kImageMagic, sizeof(header.magic));
+  header.version = kImageVersion;
+  header.numSymbols = names.size();
+  header.numProductions = productionOffsets.size() - 1;
+  header.numItems = items.size();
+  header.stringBytes = pool.size();
+  map<string, uint32_t>::const_iterator start = indices.find("<start>");
+  header.startSymbol = (start == indices.end()) ? kNoSymbol : start->second;
+
+  ofstream outfile(filename.c_str(), ios::out | ios::binary | ios::trunc);
+  if (outfile.fail()) return false;
+  outfile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  writeWords(outfile, symbolTable);
+  writeWords(outfile, productionOffsets);
+  writeWords(outfile, aliasTable);
+  writeWords(outfile, items);
+  outfile.write(pool.data(), pool.size());
+  outfile.close();
+  return !outfile.fail();
+}
+
+GrammarImage::GrammarImage() : base(NULL), length(0), header(NULL) {}
+
+GrammarImage::~GrammarImage()
+{
+  close();
+}
+
+/**
+ * Method: close
+ * -------------
+ * Releases the mapping, if any, and resets the
+ * GrammarImage to its unopened state.
+ */
+
+void GrammarImage::close()
+{
+  if (base != NULL) munmap(base, length);
+  base = NULL;
+  length = 0;
+  header = NULL;
+}
+
+/**
+ * Method: open
+ * ------------
+ * Maps the entire file read-only and carves it up into the
+ * tables described in grammarimage.h.  Every offset stored in
+ * the item, production and alias tables, and every weight, is
+ * checked here, once, so that generation can trust them without checking
+ * again.
+ */
+
+bool GrammarImage::open(const string& filename)
+{
+  close();
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd == -1) return false;
+  struct stat info;
+  if (fstat(fd, &info) == -1 || info.st_size < (off_t) sizeof(Header)) {
+    ::close(fd);
+    return false;
+  }
+
+  length = info.st_size;
+  base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    base = NULL;
+    length = 0;
+    return false;
+  }
+
+  header = static_cast<const Header *>(base);
+  if (memcmp(header->magic, kImageMagic, sizeof(header->magic)) != 0 ||
+      header->version != kImageVersion) {
+    close();
+    return false;
+  }
+
+  size_t words = 4 * (size_t) header->numSymbols + 3 * (size_t) header->numProductions + 1 + header->numItems;
+  if (sizeof(Header) + words * sizeof(uint32_t) + header->stringBytes != length) {
+    close();
+    return false;
+  }
+
+  const uint32_t *tables = reinterpret_cast<const uint32_t *>(header + 1);
+  symbols = reinterpret_cast<const Symbol *>(tables);
+  productionOffsets = tables + 4 * header->numSymbols;
+  aliases = reinterpret_cast<const Alias *>(productionOffsets + header->numProductions + 1);
+  items = productionOffsets + header->numProductions + 1 + 2 * header->numProductions;
+  strings = reinterpret_cast<const char *>(items + header->numItems);
+
+  bool valid = (header->stringBytes == 0 || strings[header->stringBytes - 1] == '\0') &&
+               (header->startSymbol == kNoSymbol || header->startSymbol < header->numSymbols) &&
+               productionOffsets[header->numProductions] == header->numItems;
+  for (uint32_t i = 0; valid && i < header->numSymbols; i++) {
+    valid = symbols[i].name < header->stringBytes &&
+            symbols[i].firstProduction + (uint64_t) symbols[i].numProductions <= header->numProductions;
+  }
+  for (uint32_t i = 0; valid && i < header->numSymbols; i++) {
+    const Symbol& sym = symbols[i];
+    valid = sym.totalWeight <= INT_MAX && sym.totalWeight >= sym.numProductions;
+    for (uint32_t j = 0; valid && j < sym.numProductions; j++) {
+      const Alias& column = aliases[sym.firstProduction + j];
+      valid = column.threshold <= sym.totalWeight && column.alias < sym.numProductions;
+    }
+  }
+  for (uint32_t i = 0; valid && i < header->numProductions; i++) {
+    valid = productionOffsets[i] <= productionOffsets[i + 1];
+  }
+  for (uint32_t i = 0; valid && i < header->numItems; i++) {
+    valid = (items[i] & kNonterminalBit) ? (items[i] & ~kNonterminalBit) < header->numSymbols
+                                         : items[i] < header->stringBytes;
+  }
+
+  if (!valid) close();
+  return valid;
+}
+
+int GrammarImage::getNumDefinitions() const
+{
+  if (header == NULL) return 0;
+  int count = 0;
+  for (uint32_t i = 0; i < header->numSymbols; i++) {
+    if (symbols[i].numProductions > 0) count++;
+  }
+  return count;
+}
+
+bool GrammarImage::generate(RandomGenerator& random, vector<const char *>& sentence) const
+{
+  if (header == NULL || header->startSymbol == kNoSymbol) return false;
+  expand(header->startSymbol, random, sentence);
+  return true;
+}
+
+/**
+ * Method: expand
+ * --------------
+ * Chooses one of the symbol's productions against its alias table,
+ * drawing exactly what Definition::getRandomProduction draws: a column,
+ * and then, unless every weight is 1, a number below the total weight
+ * to decide between the column and its alias.  Then it expands that
+ * production's items in order.
+ */
+
+void GrammarImage::expand(uint32_t symbol, RandomGenerator& random, vector<const char *>& sentence) const
+{
+  const Symbol& sym = symbols[symbol];
+  if (sym.numProductions == 0) {
+    sentence.push_back(strings + sym.name);
+    return;
+  }
+
+  uint32_t column = random.getRandomInteger(0, sym.numProductions - 1);
+  if (sym.totalWeight != sym.numProductions) {
+    uint32_t coin = random.getRandomInteger(0, sym.totalWeight - 1);
+    if (coin >= aliases[sym.firstProduction + column].threshold) column = aliases[sym.firstProduction + column].alias;
+  }
+  uint32_t chosen = sym.firstProduction + column;
+  for (uint32_t i = productionOffsets[chosen]; i < productionOffsets[chosen + 1]; i++) {
+    if (items[i] & kNonterminalBit) {
+      expand(items[i] & ~kNonterminalBit, random, sentence);
+    } else {
+      sentence.push_back(strings + items[i]);
+    }
+  }
+}
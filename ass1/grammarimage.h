@@ -0,0 +1,152 @@
+#ifndef __grammarimage__
+#define __grammarimage__
+
+/**
+ * File: grammarimage.h
+ * --------------------
+ * Defines the GrammarImage class, which manages the compact
+ * binary form of a grammar.  A text grammar is parsed exactly
+ * once and compiled into an image file; every later run maps
+ * that image into memory and generates straight out of it, without
+ * any parsing, string construction or map lookups.
+ *
+ * The image is a flat sequence of 32-bit words in host byte order:
+ *
+ *     header            magic, version and the sizes of every table below
+ *     symbol table      one record per nonterminal: name, first production, production count,
+ *                       total weight of its productions
+ *     production table  numProductions + 1 offsets into the item table
+ *     alias table       one record per production: its threshold and its alias (a position
+ *                       within the same definition) in the definition's alias table
+ *     item table        terminals (string offsets) and nonterminals (symbol index | kNonterminalBit)
+ *     string pool       '\0'-terminated terminal and nonterminal names
+ *
+ * The alias tables are copied straight from the Definitions (see
+ * definition.h), and productions are chosen against them with the same
+ * draws, so an image generates exactly what its text grammar does under
+ * the same seed.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "definition.h"
+#include "random.h"
+using namespace std;
+
+class GrammarImage {
+
+ public:
+
+  /**
+   * Static Method: compile
+   * ----------------------
+   * Writes the binary image of the supplied grammar to the named file.
+   * Nonterminals that are referenced but never defined are compiled
+   * as symbols without any productions, and they expand to their own
+   * name at generation time.
+   *
+   * @param grammar the fully loaded grammar to be compiled.
+   * @param filename the name of the image file to be (over)written.
+   * @return true if and only if the image was written in full, which
+   *         it isn't if some definition's weights add up to more than
+   *         the image format's INT_MAX.
+   */
+
+  static bool compile(const map<string, Definition>& grammar, const string& filename);
+
+  /**
+   * Constructor: GrammarImage
+   * -------------------------
+   * Constructs a GrammarImage that isn't yet attached to any image file.
+   */
+
+  GrammarImage();
+
+  /**
+   * Destructor: ~GrammarImage
+   * -------------------------
+   * Unmaps the image file, if one was ever opened.
+   */
+
+  ~GrammarImage();
+
+  /**
+   * Method: open
+   * ------------
+   * Maps the named image file into memory and validates its header and
+   * table sizes.  Nothing is copied or parsed; the tables are used in place.
+   *
+   * @param filename the name of an image file written by compile.
+   * @return true if the image was mapped and found to be well formed, and
+   *         false otherwise (in which case the GrammarImage stays closed).
+   */
+
+  bool open(const string& filename);
+
+  /**
+   * Method: getNumDefinitions
+   * -------------------------
+   * Returns the number of nonterminals that have at least one production.
+   */
+
+  int getNumDefinitions() const;
+
+  /**
+   * Method: generate
+   * ----------------
+   * Expands the image's <start> symbol into a random sentence.  The
+   * terminals are appended to sentence as pointers into the mapped
+   * string pool, so they remain valid for as long as the image is open.
+   *
+   * @param random the generator used to choose among productions.
+   * @param sentence the vector to which the generated terminals are appended.
+   * @return false if the image has no <start> symbol, and true otherwise.
+   */
+
+  bool generate(RandomGenerator& random, vector<const char *>& sentence) const;
+
+ private:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t numSymbols;
+    uint32_t numProductions;
+    uint32_t numItems;
+    uint32_t stringBytes;
+    uint32_t startSymbol;
+  };
+
+  struct Symbol {
+    uint32_t name;
+    uint32_t firstProduction;
+    uint32_t numProductions;
+    uint32_t totalWeight;
+  };
+
+  struct Alias {
+    uint32_t threshold;
+    uint32_t alias;
+  };
+
+  static const uint32_t kNonterminalBit = 0x80000000u;
+  static const uint32_t kNoSymbol = 0xffffffffu;
+
+  void close();
+  void expand(uint32_t symbol, RandomGenerator& random, vector<const char *>& sentence) const;
+
+  void *base;
+  size_t length;
+  const Header *header;
+  const Symbol *symbols;
+  const uint32_t *productionOffsets;
+  const Alias *aliases;
+  const uint32_t *items;
+  const char *strings;
+
+  GrammarImage(const GrammarImage&);              // not copyable: owns a mapping
+  GrammarImage& operator=(const GrammarImage&);
+};
+
+#endif // ! __grammarimage__
@@ -9,6 +9,8 @@
 
 #include "production.h"
 #include <iostream>
+#include <sstream>
+#include <cstring>
 
 using namespace std;
 /**
@@ -23,22 +25,54 @@ using namespace std;
  * to their own productions) are delimited by '<' and '>' and 
  * that no whitespace appears in between '<' and '>'.  The implementation
  * will also read the whitespace and the '\n' appearing after the 
- * semicolon and discard it.
+ * semicolon and discard it, save for an optional weight.
  *
  * You are more than welcome to update this implementation to do
  * something else if you'd like to.
  */
 
-Production::Production(ifstream& infile)  // phrases is constructed, size is 0
+Production::Production(ifstream& infile, Arena& arena) : weight(1)
 {
+  vector<const char *> words;
+  string token;
   while (true) {
-    string token;
     infile >> token;  // ignores whitespace by default
     if (token == ";") break;
-    phrases.push_back(token);
+    words.push_back(arena.intern(token));
   }
+  adopt(words, arena);
 
   string uselessText;
   getline(infile, uselessText); // read everything else as if it's important
-  // oh, no it's not.. it's useless.. but we're glad it's been pulled from the stream..
+  // oh, no it's not.. it's useless.. unless it leads with a weight
+  istringstream tail(uselessText);
+  string extra;
+  if (!(tail >> ws).eof() && (!(tail >> weight) || weight <= 0 || tail >> extra)) weight = 0;
+}
+
+Production::Production(const vector<string>& words, Arena& arena, int weight) : weight(weight)
+{
+  vector<const char *> interned;
+  for (size_t i = 0; i < words.size(); i++) interned.push_back(arena.intern(words[i]));
+  adopt(interned, arena);
+}
+
+/**
+ * Method: adopt
+ * -------------
+ * Copies the (already interned) words into an array allocated
+ * out of the Arena, and makes that array the Production's items.
+ */
+
+void Production::adopt(const vector<const char *>& words, Arena& arena)
+{
+  numItems = words.size();
+  items = static_cast<const char **>(arena.allocate(numItems * sizeof(const char *)));
+  for (int i = 0; i < numItems; i++) items[i] = words[i];
+}
+
+bool Production::isNonterminal(const char *item)
+{
+  size_t length = strlen(item);
+  return length >= 2 && item[0] == '<' && item[length - 1] == '>';
 }
@@ -13,6 +13,7 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include "arena.h"
 using namespace std;
 
 class Production {
@@ -21,11 +22,12 @@ class Production {
   
   /**
    * Provides STL-like iterator access to the sequence of items making up
-   * a Production instance.
+   * a Production instance.  Items are '\0'-terminated strings owned by
+   * the Arena the Production was read into.
    */
   
-  typedef vector<string>::iterator iterator;
-  typedef vector<string>::const_iterator const_iterator;
+  typedef const char *const *iterator;
+  typedef const char *const *const_iterator;
   
  public:
   
@@ -44,7 +46,7 @@ class Production {
    * have a default constructor.
    */
   
-  Production() {}
+  Production() : items(NULL), numItems(0), weight(1) {}
   
   /**
    * ifstream Constructor: Production
@@ -54,19 +56,46 @@ class Production {
    * positions at the start of a line that houses a production.
    * Leading whitespace is discarded, the series of terminals and
    * non-terminals are read in until a semicolon is consumed, and
-   * the the rest of the data is discarded.
+   * the the rest of the line is discarded.  The one exception is an
+   * optional positive integer right after the semicolon, which is
+   * taken to be the production's relative weight:
+   *
+   *     ( <start> <operator> <start> ) ; 1
+   *     <single> ; 3
+   *
+   * Productions without an explicit weight have a weight of 1.
+   * Anything else after the semicolon, be it 0, a negative number,
+   * a number too large for an int or something that isn't a number
+   * at all, leaves the Production with a weight of 0, which
+   * readGrammar reports as an error rather than guessing at.
+   * The items themselves are interned into the supplied Arena,
+   * which must outlive the Production.
    */
   
-  Production(ifstream& infile);
+  Production(ifstream& infile, Arena& arena);
   
   /**
    * vector<string>-backed Constructor: Production
    * ---------------------------------------------
-   * Initializes a new Production to just encapsulate
-   * a copy of the provided vector.
+   * Initializes a new Production to encapsulate
+   * copies of the provided words, interned into the
+   * supplied Arena.
+   */
+  
+  Production(const vector<string>& words, Arena& arena, int weight = 1);
+  
+  /**
+   * Move Constructor and Assignment: Production
+   * -------------------------------------------
+   * Productions can be moved but never copied: a move just
+   * hands over the pointer into the Arena, so storing a
+   * Production in a vector never duplicates its items.
    */
   
-  Production(const vector<string>& words) : phrases(words) {}
+  Production(Production&& other) = default;
+  Production& operator=(Production&& other) = default;
+  Production(const Production& other) = delete;
+  Production& operator=(const Production& other) = delete;
   
   /**
    * Iterators: begin, end
@@ -82,17 +111,46 @@ class Production {
    * words, can be traversed via iterators using the following
    * control idiom.
    *
-   *    for (Production::iterator curr = prod.begin(); curr != prod.end(); ++curr) {
-   *        // manipulate curr (psuedo-pointer to C++ strings) or *curr (direct string objects).
+   *    for (Production::const_iterator curr = prod.begin(); curr != prod.end(); ++curr) {
+   *        // manipulate curr (pointer to a C string) or *curr (the C string itself).
+   */
+  
+  const_iterator begin() const { return items; }
+  const_iterator end() const { return items + numItems; }
+  
+  /**
+   * Method: size
+   * ------------
+   * Returns the number of items making up the Production.
    */
   
-  iterator begin() { return phrases.begin(); }
-  const_iterator begin() const { return phrases.begin(); }
-  iterator end() { return phrases.end(); }
-  const_iterator end() const { return phrases.end(); }
+  int size() const { return numItems; }
+  
+  /**
+   * Method: getWeight
+   * -----------------
+   * Returns the relative weight of the Production, which
+   * is always at least 1 in a grammar readGrammar accepted,
+   * and 0 if the weight in the grammar file was malformed.
+   */
+  
+  int getWeight() const { return weight; }
+  
+  /**
+   * Function: isNonterminal
+   * -----------------------
+   * Returns true if and only if the specified item is
+   * spelled like a nonterminal, i.e. "<" ... ">".
+   */
+  
+  static bool isNonterminal(const char *item);
   
  private:
-  vector<string> phrases;
+  void adopt(const vector<const char *>& words, Arena& arena);
+  
+  const char **items;
+  int numItems;
+  int weight;
 };
 
 #endif
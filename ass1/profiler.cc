@@ -0,0 +1,81 @@
+/**
+ * File: profiler.cc
+ * -----------------
+ * Provides the implementation of the Profiler class.  Times come
+ * from the monotonic clock, in nanoseconds.  An expansion's self
+ * time is its total time less the total time of the expansions
+ * directly inside it.
+ */
+
+#include "profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <time.h>
+using namespace std;
+
+static int64_t now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void Profiler::enter(const char *nonterminal, int depth, long tokens)
+{
+  Frame frame;
+  frame.nonterminal = nonterminal;
+  frame.stats = &stats[nonterminal];
+  frame.childTime = 0;
+  frame.startTokens = tokens;
+  frame.pathLength = path.size();
+  if (!path.empty()) path += ';';
+  path += nonterminal;
+
+  frame.stats->expansions++;
+  frame.stats->maxDepth = max(frame.stats->maxDepth, depth);
+  frame.stats->active++;
+  frame.start = now();
+  stack.push_back(frame);
+}
+
+void Profiler::exit(long tokens)
+{
+  int64_t elapsed = now() - stack.back().start;
+  Frame& frame = stack.back();
+  int64_t self = elapsed - frame.childTime;
+  frame.stats->selfTime += self;
+  if (--frame.stats->active == 0) {
+    frame.stats->totalTime += elapsed;
+    frame.stats->tokens += tokens - frame.startTokens;
+  }
+  folded[path] += self;
+  path.resize(frame.pathLength);
+  stack.pop_back();
+  if (!stack.empty()) stack.back().childTime += elapsed;
+}
+
+void Profiler::printReport(ostream& out) const
+{
+  vector<pair<int64_t, const char *> > order;
+  for (unordered_map<const char *, Stats>::const_iterator curr = stats.begin(); curr != stats.end(); ++curr) {
+    order.push_back(make_pair(-curr->second.selfTime, curr->first));
+  }
+  sort(order.begin(), order.end());
+
+  out << left << setw(32) << "Nonterminal" << right << setw(12) << "Expansions" << setw(12) << "Tokens"
+      << setw(12) << "Tokens/exp" << setw(11) << "Max depth" << setw(14) << "Total (us)" << setw(14) << "Self (us)" << endl;
+  for (size_t i = 0; i < order.size(); i++) {
+    const Stats& s = stats.find(order[i].second)->second;
+    out << left << setw(32) << order[i].second << right << setw(12) << s.expansions << setw(12) << s.tokens
+        << setw(12) << fixed << setprecision(2) << (double) s.tokens / s.expansions << setw(11) << s.maxDepth
+        << setw(14) << setprecision(1) << s.totalTime / 1e3 << setw(14) << s.selfTime / 1e3 << endl;
+  }
+}
+
+void Profiler::printFolded(ostream& out) const
+{
+  for (map<string, int64_t>::const_iterator curr = folded.begin(); curr != folded.end(); ++curr) {
+    out << curr->first << ' ' << curr->second << '\n';
+  }
+  out.flush();
+}
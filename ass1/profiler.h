@@ -0,0 +1,98 @@
+#ifndef __profiler__
+#define __profiler__
+
+/**
+ * File: profiler.h
+ * ----------------
+ * Defines the Profiler class, which an Expander can report to while
+ * it expands.  For every nonterminal it records how often it was
+ * expanded, how many terminals those expansions produced, how deep
+ * in the expansion it was ever found, and how much time was spent
+ * expanding it: in total, and in itself rather than in the
+ * nonterminals it expanded into.
+ *
+ * Totals for a recursive nonterminal only count its outermost
+ * expansions, so the time and terminals spent in nested copies of
+ * it aren't counted more than once.
+ */
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+using namespace std;
+
+class Profiler {
+
+ public:
+
+  /**
+   * Method: enter
+   * -------------
+   * Records the start of an expansion of the named nonterminal at
+   * the specified depth.  tokens is the number of terminals the
+   * Expander had produced before starting it.  The name must stay
+   * valid for as long as the Profiler does.
+   */
+
+  void enter(const char *nonterminal, int depth, long tokens);
+
+  /**
+   * Method: exit
+   * ------------
+   * Records the end of the most recently entered expansion.  tokens
+   * is the number of terminals the Expander has now produced.
+   */
+
+  void exit(long tokens);
+
+  /**
+   * Method: printReport
+   * -------------------
+   * Prints one line per nonterminal, those with the most self
+   * time first.
+   */
+
+  void printReport(ostream& out) const;
+
+  /**
+   * Method: printFolded
+   * -------------------
+   * Prints the self time of every distinct stack of nonterminals,
+   * in nanoseconds, in the "folded" format read by flamegraph.pl
+   * and similar tools:
+   *
+   *     <start>;<plea>;<dubious-excuse> 5210
+   */
+
+  void printFolded(ostream& out) const;
+
+ private:
+  struct Stats {
+    Stats() : expansions(0), tokens(0), maxDepth(0), totalTime(0), selfTime(0), active(0) {}
+    long expansions;
+    long tokens;
+    int maxDepth;
+    int64_t totalTime;
+    int64_t selfTime;
+    int active;
+  };
+
+  struct Frame {
+    const char *nonterminal;
+    Stats *stats;
+    int64_t start;
+    int64_t childTime;
+    long startTokens;
+    size_t pathLength;
+  };
+
+  unordered_map<const char *, Stats> stats;
+  vector<Frame> stack;
+  string path;
+  map<string, int64_t> folded;
+};
+
+#endif // ! __profiler__
@@ -0,0 +1,85 @@
+/**
+ * File: random-bench.cc
+ * ---------------------
+ * Micro-benchmark comparing the original rand()-based
+ * getRandomInteger against RandomGenerator layered over each
+ * of the available RandomSources.  Each contender draws the
+ * same number of integers from a small range, which is what
+ * expanding a flat grammar asks for over and over again.
+ *
+ *     ./random-bench [number of draws]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#include <sys/time.h>
+#include "random.h"
+using namespace std;
+
+static const int kDefaultNumDraws = 20000000;
+static const int kHigh = 6;      // a typical Definition has a handful of Productions
+
+/**
+ * Function: legacyGetRandomInteger
+ * --------------------------------
+ * The implementation RandomGenerator used to have: a floating
+ * point division applied to every rand() call.
+ */
+
+static int legacyGetRandomInteger(int low, int high)
+{
+  double percent = (rand() / (static_cast<double>(RAND_MAX) + 1));
+  int offset = static_cast<int>(percent * (high - low + 1));
+  return low + offset;
+}
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void report(const string& name, int numDraws, double seconds, long checksum)
+{
+  cout << setw(24) << left << name
+       << setw(10) << right << fixed << setprecision(2) << seconds * 1e9 / numDraws << " ns/draw"
+       << setw(12) << fixed << setprecision(1) << numDraws / seconds / 1e6 << " M draws/s"
+       << "   (checksum " << checksum << ")" << endl;
+}
+
+static void benchmarkLegacy(int numDraws)
+{
+  srand(1);
+  long checksum = 0;
+  double start = now();
+  for (int i = 0; i < numDraws; i++) checksum += legacyGetRandomInteger(0, kHigh);
+  report("legacy rand() / double", numDraws, now() - start, checksum);
+}
+
+static void benchmarkSource(const string& name, int numDraws)
+{
+  RandomGenerator random(unique_ptr<RandomSource>(RandomSource::create(name, 1)));
+  long checksum = 0;
+  double start = now();
+  for (int i = 0; i < numDraws; i++) checksum += random.getRandomInteger(0, kHigh);
+  report("RandomGenerator/" + name, numDraws, now() - start, checksum);
+}
+
+int main(int argc, char *argv[])
+{
+  int numDraws = (argc > 1) ? atoi(argv[1]) : kDefaultNumDraws;
+  if (numDraws <= 0) {
+    cerr << "Usage: random-bench [number of draws]" << endl;
+    return 1;
+  }
+
+  cout << "Drawing " << numDraws << " integers from [0, " << kHigh << "] with each generator." << endl;
+  benchmarkLegacy(numDraws);
+  benchmarkSource("libc", numDraws);
+  benchmarkSource("pcg", numDraws);
+  benchmarkSource("xoshiro", numDraws);
+  return 0;
+}
@@ -4,6 +4,91 @@
 #include <cassert> // for assert macro
 #include "random.h"
 
+RandomSource *RandomSource::create(const std::string& name, uint64_t seed)
+{
+  if (name == "xoshiro") return new Xoshiro256StarStar(seed);
+  if (name == "pcg") return new Pcg32(seed);
+  if (name == "libc") return new LibcRandomSource(seed);
+  return NULL;
+}
+
+/**
+ * Function: splitmix64
+ * --------------------
+ * Advances the specified state and returns the next output of
+ * Vigna's splitmix64, which is the recommended way of expanding
+ * a single 64-bit seed into a full xoshiro state.
+ */
+
+static uint64_t splitmix64(uint64_t& state)
+{
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+void Xoshiro256StarStar::seed(uint64_t value)
+{
+  for (int i = 0; i < 4; i++) state[i] = splitmix64(value);
+}
+
+uint64_t Xoshiro256StarStar::next64()
+{
+  uint64_t result = rotl(state[1] * 5, 7) * 9;
+  uint64_t t = state[1] << 17;
+  state[2] ^= state[0];
+  state[3] ^= state[1];
+  state[1] ^= state[2];
+  state[0] ^= state[3];
+  state[2] ^= t;
+  state[3] = rotl(state[3], 45);
+  return result;
+}
+
+void Pcg32::seed(uint64_t value)
+{
+  state = 0;
+  increment = (value << 1) | 1;   // the stream is derived from the seed as well
+  next32();
+  state += value;
+  next32();
+}
+
+uint32_t Pcg32::next32()
+{
+  uint64_t old = state;
+  state = old * 6364136223846793005ULL + increment;
+  uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+  uint32_t rotation = old >> 59;
+  return (xorshifted >> rotation) | (xorshifted << ((-rotation) & 31));
+}
+
+void LibcRandomSource::seed(uint64_t value)
+{
+  srand(value);
+}
+
+/**
+ * Method: next32
+ * --------------
+ * rand() is only guaranteed to supply 15 bits at a time (glibc
+ * supplies 31), so three calls are stitched together to be safe.
+ */
+
+uint32_t LibcRandomSource::next32()
+{
+  uint32_t high = rand() & 0x7fff;
+  uint32_t middle = rand() & 0x7fff;
+  uint32_t low = rand() & 0x3;
+  return (high << 17) | (middle << 2) | low;
+}
+
 /**
  * Constructor: RandomGenerator
  * ----------------------------
@@ -13,25 +98,73 @@
  * program to use random numbers.
  */
 
-RandomGenerator::RandomGenerator()
+RandomGenerator::RandomGenerator() : source(new Xoshiro256StarStar(time(NULL))) {}
+
+/**
+ * Constructor: RandomGenerator
+ * ----------------------------
+ * Initializes a RandomGenerator number generator with
+ * an explicit seed, for reproducible runs.
+ */
+
+RandomGenerator::RandomGenerator(uint64_t seed) : source(new Xoshiro256StarStar(seed)) {}
+
+RandomGenerator::RandomGenerator(std::unique_ptr<RandomSource> source) : source(source.release())
+{
+  assert(this->source != NULL);
+}
+
+RandomGenerator::~RandomGenerator()
 {
-  srand(time(NULL));
+  delete source;
 }
 
 /**
  * Method: getRandomInteger
  * ------------------------
  * Returns a seemingly random number between
- * the specified low and high, inclusive.  Based
- * on Eric Roberts' implementation from his
- * CS106A text.
+ * the specified low and high, inclusive.  Uses Lemire's
+ * multiply-and-shift method: the 32 random bits are scaled into
+ * [0, range) by a 64-bit multiply instead of a division, and the
+ * few leftover values that would make some outcomes more likely
+ * than others are rejected, so every outcome is exactly as likely
+ * as every other.  The division needed to find those leftovers is
+ * only performed when a draw lands close enough to need it.
  */
 
 int RandomGenerator::getRandomInteger(int low, int high)
 {
   assert(low <= high);
-  double percent = (rand() / (static_cast<double>(RAND_MAX) + 1));
-  assert(percent >= 0.0 && percent < 1.0); 
-  int offset = static_cast<int>(percent * (high - low + 1));
-  return low + offset;
+  uint32_t range = static_cast<uint32_t>(static_cast<int64_t>(high) - low) + 1;
+  if (range == 0) return static_cast<int>(source->next32());   // [INT_MIN, INT_MAX]
+  uint64_t scaled = static_cast<uint64_t>(source->next32()) * range;
+  uint32_t leftover = static_cast<uint32_t>(scaled);
+  if (leftover < range) {
+    uint32_t threshold = -range % range;
+    while (leftover < threshold) {
+      scaled = static_cast<uint64_t>(source->next32()) * range;
+      leftover = static_cast<uint32_t>(scaled);
+    }
+  }
+  return static_cast<int>(low + static_cast<int64_t>(scaled >> 32));
+}
+
+/**
+ * Method: getRandomLong
+ * ---------------------
+ * Returns a seemingly random number between the specified low
+ * and high, inclusive.  Draws 64 bits at a time and reduces them
+ * modulo the size of the range, rejecting the few lowest draws
+ * that would otherwise make some outcomes more likely than others.
+ */
+
+long long RandomGenerator::getRandomLong(long long low, long long high)
+{
+  assert(low <= high);
+  uint64_t range = static_cast<uint64_t>(high) - static_cast<uint64_t>(low) + 1;
+  uint64_t bits = static_cast<uint64_t>(source->next32()) << 32 | source->next32();
+  if (range == 0) return static_cast<long long>(bits);   // [LLONG_MIN, LLONG_MAX]
+  uint64_t threshold = -range % range;
+  while (bits < threshold) bits = static_cast<uint64_t>(source->next32()) << 32 | source->next32();
+  return static_cast<long long>(static_cast<uint64_t>(low) + bits % range);
 }
@@ -6,8 +6,105 @@
  * --------------
  * Provides a random number generator so
  * that pseudo-random numbers can be produced.
+ *
+ * The raw bits come from a pluggable RandomSource, so that the
+ * algorithm can be swapped without touching any client of
+ * RandomGenerator.  Three sources are provided: xoshiro256**
+ * (the default), PCG32, and the traditional libc rand().
  */
 
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+class RandomSource {
+
+ public:
+
+  virtual ~RandomSource() {}
+
+  /**
+   * Method: next32
+   * --------------
+   * Returns the next 32 uniformly distributed bits.
+   */
+
+  virtual uint32_t next32() = 0;
+
+  /**
+   * Method: seed
+   * ------------
+   * Resets the source to the state determined by the specified
+   * seed.  Equal seeds always lead to equal sequences.
+   */
+
+  virtual void seed(uint64_t value) = 0;
+
+  /**
+   * Static Method: create
+   * ---------------------
+   * Creates a dynamically allocated source implementing the named
+   * algorithm ("xoshiro", "pcg", or "libc") seeded with the specified
+   * value, or returns NULL if the name isn't recognized.  The caller
+   * owns the returned source.
+   */
+
+  static RandomSource *create(const std::string& name, uint64_t seed);
+};
+
+/**
+ * Class: Xoshiro256StarStar
+ * -------------------------
+ * Blackman and Vigna's xoshiro256**: 256 bits of state, a handful
+ * of shifts and rotations per number, and excellent statistical
+ * quality.  The state is filled out of the seed using splitmix64.
+ */
+
+class Xoshiro256StarStar : public RandomSource {
+ public:
+  Xoshiro256StarStar(uint64_t value) { seed(value); }
+  uint32_t next32() { return next64() >> 32; }
+  uint64_t next64();
+  void seed(uint64_t value);
+
+ private:
+  uint64_t state[4];
+};
+
+/**
+ * Class: Pcg32
+ * ------------
+ * O'Neill's PCG32 (XSH RR variant): a 64-bit linear congruential
+ * generator whose output is permuted down to 32 bits.
+ */
+
+class Pcg32 : public RandomSource {
+ public:
+  Pcg32(uint64_t value) { seed(value); }
+  uint32_t next32();
+  void seed(uint64_t value);
+
+ private:
+  uint64_t state;
+  uint64_t increment;
+};
+
+/**
+ * Class: LibcRandomSource
+ * -----------------------
+ * Wraps srand and rand.  Only one such source can meaningfully
+ * exist at a time, since they all share the C library's state,
+ * and every call takes the C library's lock.  It's here for
+ * comparison purposes.
+ */
+
+class LibcRandomSource : public RandomSource {
+ public:
+  LibcRandomSource(uint64_t value) { seed(value); }
+  uint32_t next32();
+  void seed(uint64_t value);
+};
+
 class RandomGenerator {
   
  public: 
@@ -15,11 +112,42 @@ class RandomGenerator {
   /**
    * Constructor: RandomGenerator
    * ----------------------------
-   * Constructs a new RandomGenerator object.
+   * Constructs a new RandomGenerator object, backed by an
+   * xoshiro256** source seeded from the current time.
    */
   
   RandomGenerator();
 
+  /**
+   * Constructor: RandomGenerator
+   * ----------------------------
+   * Constructs a new RandomGenerator object seeded with the
+   * specified value, so that the sequence of numbers it produces
+   * is the same every time the program is run with that seed.
+   */
+
+  explicit RandomGenerator(uint64_t seed);
+
+  /**
+   * Constructor: RandomGenerator
+   * ----------------------------
+   * Constructs a new RandomGenerator object that draws its bits
+   * from the supplied source.  The RandomGenerator takes ownership
+   * of the source and deletes it when it is itself destroyed.  The
+   * source is passed as a unique_ptr rather than a raw pointer so that
+   * a literal seed of 0 unambiguously picks the seed constructor.
+   */
+
+  explicit RandomGenerator(std::unique_ptr<RandomSource> source);
+
+  /**
+   * Destructor: ~RandomGenerator
+   * ----------------------------
+   * Disposes of the embedded RandomSource.
+   */
+
+  ~RandomGenerator();
+
   /**
    * Method: getRandomInteger
    * ------------------------
@@ -35,6 +163,37 @@ class RandomGenerator {
    */
   
   int getRandomInteger(int low, int high);  
+
+  /**
+   * Method: getRandomLong
+   * ---------------------
+   * Operates exactly like getRandomInteger, except that the range
+   * may be wider than an int, as it is when the weights of a
+   * Definition's Productions add up to more than INT_MAX.
+   *
+   * @param the lowest number we'd like to be considered as a return value.
+   * @param the highest number we'd like to be considered as a return value.
+   * @return some number drawn uniformly from the range [low, high].
+   */
+
+  long long getRandomLong(long long low, long long high);
+
+  /**
+   * Method: seed
+   * ------------
+   * Reseeds the underlying source, so that from here on the
+   * RandomGenerator produces exactly the numbers a brand new one
+   * layered over the same kind of source and seeded with the same
+   * value would.
+   */
+
+  void seed(uint64_t value) { source->seed(value); }
+
+ private:
+  RandomSource *source;
+
+  RandomGenerator(const RandomGenerator&);              // not copyable: owns its source
+  RandomGenerator& operator=(const RandomGenerator&);
 };
 
 #endif // ! __random__
@@ -9,36 +9,25 @@
  
 #include <map>
 #include <fstream>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include "arena.h"
+#include "allocstats.h"
 #include "definition.h"
 #include "production.h"
+#include "grammarimage.h"
+#include "grammaranalysis.h"
+#include "expander.h"
+#include "enumerator.h"
+#include "profiler.h"
+#include "server.h"
+#include "sentencewriter.h"
+#include "random.h"
 using namespace std;
 
-/**
- * Takes a reference to a legitimate infile (one that's been set up
- * to layer over a file) and populates the grammar map with the
- * collection of definitions that are spelled out in the referenced
- * file.  The function is written under the assumption that the
- * referenced data file is really a grammar file that's properly
- * formatted.  You may assume that all grammars are in fact properly
- * formatted.
- *
- * @param infile a valid reference to a flat text file storing the grammar.
- * @param grammar a reference to the STL map, which maps nonterminal strings
- *                to their definitions.
- */
-
-static void readGrammar(ifstream& infile, map<string, Definition>& grammar)
-{
-  while (true) {
-    string uselessText;
-    getline(infile, uselessText, '{');
-    if (infile.eof()) return;  // true? we encountered EOF before we saw a '{': no more productions!
-    infile.putback('{');
-    Definition def(infile);
-    grammar[def.getNonterminal()] = def;
-  }
-}
-
 /**
  * Performs the rudimentary error checking needed to confirm that
  * the client provided a grammar file.  It then continues to
@@ -56,63 +45,289 @@ static void readGrammar(ifstream& infile, map<string, Definition>& grammar)
  */
 
 
-bool is_terminal(string s) {
-  if (s[0] == '<' && s[s.length() - 1] == '>') return true;
+void generate_sequences(Expander &expander) {
+  SentenceWriter writer(cout);
+  for (int i = 0; i < 3; i++) {
+    writer.beginSentence(i + 1);
+    expander.expand("<start>", writer);
+    writer.endSentence();
+  }
+}
+
+/**
+ * Looks for the named option (e.g. "--seed") among the command line
+ * arguments.  If it's there, its value (the argument right after it)
+ * is copied into value, and both are removed from argv so that the
+ * positional arguments can be handled as if the option never appeared.
+ *
+ * @return true if and only if the option was supplied along with a value.
+ */
+
+static bool extractOption(int& argc, char *argv[], const string& name, string& value) {
+  for (int i = 1; i < argc - 1; i++) {
+    if (name == argv[i]) {
+      value = argv[i + 1];
+      for (int j = i; j + 2 <= argc; j++) argv[j] = argv[j + 2];
+      argc -= 2;
+      return true;
+    }
+  }
   return false;
 }
 
-void generate_sequence(map<string, Definition> &grammar, vector<string> &v) {
-  for (int i = 0; i < v.size(); i++) {
-    if (is_terminal(v[i])) {
-      Production prod = grammar[v[i]].getRandomProduction();
-      vector<string> tmp;
-     
-      if (i < v.size() - 1) {
-        for (int j = i + 1; j < v.size(); j++) {
-         tmp.push_back(v[j]);
-        }
-      }
-      v.erase(v.begin() + i, v.end());
-     
-      for (Production::iterator it = prod.begin(); it != prod.end(); ++it) {
-        string s = *it;
-        
-        v.push_back(s);
-      }
-     
-      for (int j = 0; j < tmp.size(); j++) {
-        v.push_back(tmp[j]);
-      }
-      
-      generate_sequence(grammar, v);
+/**
+ * Looks for the named flag (e.g. "--analyze") among the command line
+ * arguments, and removes it from argv if it's there.
+ *
+ * @return true if and only if the flag was supplied.
+ */
+
+static bool extractFlag(int& argc, char *argv[], const string& name) {
+  for (int i = 1; i < argc; i++) {
+    if (name == argv[i]) {
+      for (int j = i; j + 1 <= argc; j++) argv[j] = argv[j + 1];
+      argc--;
+      return true;
     }
   }
+  return false;
 }
 
-void generate_sequences(map<string, Definition> grammar) {
+/**
+ * Builds the RandomSource selected via "--rng <xoshiro|pcg|libc>"
+ * (xoshiro256** by default), seeded with the value supplied via
+ * "--seed <n>" or with the current time if no seed was supplied.
+ *
+ * @return the new source, or NULL if the named algorithm doesn't exist.
+ */
+
+static RandomSource *extractRandomSource(int& argc, char *argv[]) {
+  string seed, algorithm = "xoshiro";
+  uint64_t value = extractOption(argc, argv, "--seed", seed) ? strtoull(seed.c_str(), NULL, 10) : time(NULL);
+  extractOption(argc, argv, "--rng", algorithm);
+  return RandomSource::create(algorithm, value);
+}
+
+/**
+ * Compiles the text grammar named by argv[2] into the binary image named
+ * by argv[3], so that later runs can skip parsing altogether:
+ *
+ *     rsg compile data/bionic.g bionic.rsgc
+ */
+
+static int compileGrammar(int argc, char *argv[]) {
+  if (argc != 4) {
+    cerr << "Usage: rsg compile <path to grammar text file> <path to image file>" << endl;
+    return 1;
+  }
+
+  ifstream grammarFile(argv[2]);
+  if (grammarFile.fail()) {
+    cerr << "Failed to open the file named \"" << argv[2] << "\".  Check to ensure the file exists. " << endl;
+    return 2;
+  }
+
+  Arena arena;
+  map<string, Definition> grammar;
+  string error;
+  if (!readGrammar(grammarFile, grammar, arena, error)) {
+    cerr << "Failed to read the grammar in \"" << argv[2] << "\": " << error << endl;
+    return 4;
+  }
+  if (!GrammarImage::compile(grammar, argv[3])) {
+    cerr << "Failed to write the grammar image named \"" << argv[3] << "\"." << endl;
+    return 3;
+  }
+
+  cout << "Compiled " << grammar.size() << " definitions from \"" << argv[2]
+       << "\" into \"" << argv[3] << "\"." << endl;
+  return 0;
+}
+
+/**
+ * Maps the binary image named by argv[2] and prints three random sentences
+ * generated straight out of it, exactly as the text mode does:
+ *
+ *     rsg run bionic.rsgc
+ */
+
+static int runImage(int argc, char *argv[], RandomGenerator& random) {
+  if (argc != 3) {
+    cerr << "Usage: rsg run <path to image file>" << endl;
+    return 1;
+  }
+
+  GrammarImage image;
+  if (!image.open(argv[2])) {
+    cerr << "Failed to load the grammar image named \"" << argv[2] << "\".  Check to ensure it was written by rsg compile. " << endl;
+    return 2;
+  }
+
+  cout << "The grammar image called \"" << argv[2] << "\" contains "
+       << image.getNumDefinitions() << " definitions." << endl;
+
+  vector<const char *> v;
+  SentenceWriter writer(cout);
   for (int i = 0; i < 3; i++) {
-    Production prod = grammar["<start>"].getRandomProduction();
-    vector<string> v;
-    for (Production::iterator it = prod.begin(); it != prod.end(); ++it) {
-     v.push_back(*it);
+    v.clear();
+    if (!image.generate(random, v)) {
+      writer.flush();
+      cerr << "Could not find \"<start>\" in the grammar image." << endl;
+      return 3;
+    }
+    writer.beginSentence(i + 1);
+    for (size_t j = 0; j < v.size(); j++) writer.write(v[j]);
+    writer.endSentence();
+  }
+  return 0;
+}
+
+/**
+ * Handles "--count <n>", "--enumerate <n>" and "--uniform <n>", which
+ * all work with the full set of sentences of at most n terminals rather
+ * than with random expansions.  --count prints how many there are,
+ * length by length, along with the totals for every other nonterminal.
+ * --enumerate lists them all, one per line, shortest first.  --uniform
+ * prints three of them chosen uniformly at random, unlike the regular
+ * expansion, which favors short sentences.
+ *
+ * @return 0, or 4 if the grammar has infinitely many derivations.
+ */
+
+static int runEnumerator(const map<string, Definition>& grammar, const GrammarAnalysis& analysis,
+                         RandomGenerator& random, const string& mode, int maxLength) {
+  Enumerator enumerator(grammar, analysis, maxLength);
+  vector<BigInt> totals;
+  for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr) {
+    totals.push_back(enumerator.countSentences(curr->first));
+  }
+  if (!enumerator.findCycle().empty()) {
+    cerr << "The nonterminal " << enumerator.findCycle() << " can derive itself without producing "
+         << "any terminals, so the grammar has infinitely many derivations." << endl;
+    return 4;
+  }
+
+  if (mode == "count") {
+    cout << "Derivations of <start> with at most " << maxLength << " terminals: "
+         << enumerator.countSentences("<start>") << endl;
+    for (int length = 0; length <= maxLength; length++) {
+      BigInt count = enumerator.countSentences("<start>", length);
+      if (!count.isZero()) cout << setw(8) << length << "  " << count << endl;
     }
-    cout << "Version #" << i + 1 << ": --------------------------\n \t";
-    
-    generate_sequence(grammar, v);
-    for (int j = 0; j < v.size(); j++) {
-      cout << v[j] << " ";
+    cout << endl << "Derivations of every nonterminal with at most " << maxLength << " terminals:" << endl;
+    int i = 0;
+    for (map<string, Definition>::const_iterator curr = grammar.begin(); curr != grammar.end(); ++curr, ++i) {
+      cout << "  " << left << setw(30) << curr->first << right << totals[i] << endl;
+    }
+  } else if (mode == "enumerate") {
+    enumerator.enumerate("<start>", [](const vector<const char *>& sentence) {
+      for (size_t j = 0; j < sentence.size(); j++) {
+        if (j > 0) cout << ' ';
+        cout << sentence[j];
+      }
+      cout << '\n';
+    });
+    cout.flush();
+  } else {
+    SentenceWriter writer(cout);
+    vector<const char *> v;
+    for (int i = 0; i < 3; i++) {
+      v.clear();
+      if (!enumerator.sample("<start>", random, v)) break;
+      writer.beginSentence(i + 1);
+      for (size_t j = 0; j < v.size(); j++) writer.write(v[j]);
+      writer.endSentence();
     }
-    cout << endl;
-    cout << endl;
   }
+  return 0;
+}
+
+/**
+ * Loads every grammar file named by argv[1], argv[2], ... and then
+ * serves requests for sentences from them over the Unix domain socket
+ * with the specified path until interrupted (see server.h):
+ *
+ *     rsg --serve /tmp/rsg.sock data/excuse.g data/bionic.g
+ */
+
+static int serveGrammars(int argc, char *argv[], const string& socketPath, int numWorkers) {
+  if (argc == 1) {
+    cerr << "Usage: rsg [--threads <n>] --serve <socket path> <grammar files...>" << endl;
+    return 1;
+  }
+
+  GrammarServer server(numWorkers);
+  for (int i = 1; i < argc; i++) {
+    string error;
+    if (!server.addGrammar(argv[i], error)) {
+      cerr << "Failed to load the grammar in \"" << argv[i] << "\": " << error << endl;
+      return 2;
+    }
+  }
+
+  cout << "Serving " << argc - 1 << " grammars on \"" << socketPath << "\" with "
+       << numWorkers << " worker threads." << endl;
+  if (!server.serve(socketPath)) {
+    cerr << "Failed to listen on the socket named \"" << socketPath << "\"." << endl;
+    return 6;
+  }
+  return 0;
+}
+
+/**
+ * Prints how many allocations (and how many bytes) one phase of the
+ * run needed, given the counters as they stood when it started.
+ */
+
+static void printAllocations(const string& phase, long startCount, long startBytes) {
+  cerr << phase << ": " << getAllocationCount() - startCount << " allocations, "
+       << getAllocatedBytes() - startBytes << " bytes" << endl;
 }
 
 int main(int argc, char *argv[]) {
+  unique_ptr<RandomSource> source(extractRandomSource(argc, argv));
+  if (source == NULL) {
+    cerr << "Unknown random number generator.  Choose one of xoshiro, pcg or libc." << endl;
+    return 1;
+  }
+  RandomGenerator random(std::move(source));
+  bool analyzeOnly = extractFlag(argc, argv, "--analyze");
+  bool allocStats = extractFlag(argc, argv, "--alloc-stats");
+  if (allocStats && !allocationCountingEnabled()) {
+    cerr << "This rsg doesn't count allocations.  Build rsg-alloc-stats with "
+         << "\"make rsg-alloc-stats\" and run that instead." << endl;
+    return 1;
+  }
+  bool profile = extractFlag(argc, argv, "--profile");
+  string foldedFile;
+  bool profileFolded = extractOption(argc, argv, "--profile-folded", foldedFile);
+  string maxDepth = "0", maxTokens = "0";
+  extractOption(argc, argv, "--max-depth", maxDepth);
+  extractOption(argc, argv, "--max-tokens", maxTokens);
+  string socketPath, threads = to_string(max(1u, thread::hardware_concurrency()));
+  bool serving = extractOption(argc, argv, "--serve", socketPath);
+  extractOption(argc, argv, "--threads", threads);
+  string enumerateMode, enumerateLength;
+  if (extractOption(argc, argv, "--count", enumerateLength)) enumerateMode = "count";
+  if (extractOption(argc, argv, "--enumerate", enumerateLength)) enumerateMode = "enumerate";
+  if (extractOption(argc, argv, "--uniform", enumerateLength)) enumerateMode = "uniform";
+  if (serving) return serveGrammars(argc, argv, socketPath, max(1, atoi(threads.c_str())));
   if (argc == 1) {
     cerr << "You need to specify the name of a grammar file." << endl;
-    cerr << "Usage: rsg <path to grammar text file>" << endl;
+    cerr << "Usage: rsg [--seed <n>] [--rng <xoshiro|pcg|libc>] <path to grammar text file>" << endl;
+    cerr << "       rsg [--max-depth <n>] [--max-tokens <n>] <path to grammar text file>" << endl;
+    cerr << "       rsg --analyze <path to grammar text file>" << endl;
+    cerr << "       rsg-alloc-stats --alloc-stats <path to grammar text file>" << endl;
+    cerr << "       rsg [--profile] [--profile-folded <output file>] <path to grammar text file>" << endl;
+    cerr << "       rsg [--count <n> | --enumerate <n> | --uniform <n>] <path to grammar text file>" << endl;
+    cerr << "       rsg [--threads <n>] --serve <socket path> <grammar files...>" << endl;
+    cerr << "       rsg compile <path to grammar text file> <path to image file>" << endl;
+    cerr << "       rsg [--seed <n>] [--rng <xoshiro|pcg|libc>] run <path to image file>" << endl;
     return 1; // non-zero return value means something bad happened 
   }
+
+  if (string(argv[1]) == "compile") return compileGrammar(argc, argv);
+  if (string(argv[1]) == "run") return runImage(argc, argv, random);
   
   ifstream grammarFile(argv[1]);
   if (grammarFile.fail()) {
@@ -121,12 +336,53 @@ int main(int argc, char *argv[]) {
   }
   
   // things are looking good...
+  long startCount = getAllocationCount(), startBytes = getAllocatedBytes();
+  Arena arena;
   map<string, Definition> grammar;
-  readGrammar(grammarFile, grammar);
+  string error;
+  if (!readGrammar(grammarFile, grammar, arena, error)) {
+    cerr << "Failed to read the grammar in \"" << argv[1] << "\": " << error << endl;
+    return 7;
+  }
+  if (allocStats) {
+    printAllocations("Loading", startCount, startBytes);
+    cerr << "Arena: " << arena.getBytesUsed() << " bytes in " << arena.getNumBlocks() << " blocks" << endl;
+  }
+  GrammarAnalysis analysis(grammar);
+  if (analyzeOnly) {
+    analysis.printReport(cout);
+    return 0;
+  }
+
   cout << "The grammar file called \"" << argv[1] << "\" contains "
        << grammar.size() << " definitions." << endl;
+  analysis.printWarnings(cerr);
+  if (grammar.find("<start>") == grammar.end()) {
+    cerr << "Could not find \"<start>\" in the grammar file." << endl;
+    return 3;
+  }
+
+  if (!enumerateMode.empty()) {
+    return runEnumerator(grammar, analysis, random, enumerateMode, max(0, atoi(enumerateLength.c_str())));
+  }
 
-  generate_sequences(grammar);
+  Expander expander(grammar, analysis, random);
+  expander.setLimits(atoi(maxDepth.c_str()), atol(maxTokens.c_str()));
+  Profiler profiler;
+  if (profile || profileFolded) expander.setProfiler(&profiler);
+  startCount = getAllocationCount();
+  startBytes = getAllocatedBytes();
+  generate_sequences(expander);
+  if (allocStats) printAllocations("Generating", startCount, startBytes);
+  if (profile) profiler.printReport(cerr);
+  if (profileFolded) {
+    ofstream folded(foldedFile.c_str());
+    if (folded.fail()) {
+      cerr << "Failed to write the profile named \"" << foldedFile << "\"." << endl;
+      return 5;
+    }
+    profiler.printFolded(folded);
+  }
   
   return 0;
 }
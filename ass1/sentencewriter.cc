@@ -0,0 +1,91 @@
+/**
+ * File: sentencewriter.cc
+ * -----------------------
+ * Provides the implementation of the SentenceWriter class.
+ * The layout rules are exactly those of the sample application.
+ */
+
+#include "sentencewriter.h"
+#include <cstring>
+#include <cstdio>
+using namespace std;
+
+static const size_t kWrapColumn = 55;
+static const char kIndent[] = "   ";
+static const char kBanner[] = ": ---------------------------\n";
+
+bool SentenceWriter::hugsPreviousWord(const char *word)
+{
+  return word[0] == '.' || word[0] == ',' || word[0] == ';' || word[0] == ':' || word[0] == '?';
+}
+
+SentenceWriter::SentenceWriter(ostream& out, size_t capacity)
+  : out(out), buffer(capacity), used(0), column(0) {}
+
+SentenceWriter::~SentenceWriter()
+{
+  flush();
+}
+
+void SentenceWriter::beginSentence(int number)
+{
+  char banner[32];
+  append(banner, sprintf(banner, "Version #%d", number));
+  append(kBanner, sizeof(kBanner) - 1);
+  append(kIndent, sizeof(kIndent) - 1);
+  column = sizeof(kIndent) - 1;
+}
+
+void SentenceWriter::write(const char *word)
+{
+  size_t length = strlen(word);
+  if (column + length + 1 > kWrapColumn) {
+    append("\n", 1);
+    column = 0;
+  } else if (column > 0 && !hugsPreviousWord(word)) {
+    append(" ", 1);
+    column++;
+  }
+  append(word, length);
+  column += length;
+}
+
+void SentenceWriter::endSentence()
+{
+  if (column > 0) append("\n", 1);
+  append("\n", 1);
+  column = 0;
+}
+
+void SentenceWriter::flush()
+{
+  drain();
+  out.flush();
+}
+
+/**
+ * Method: append
+ * --------------
+ * Copies text into the buffer, first draining the buffer if the
+ * text doesn't fit.  Text too large for even an empty buffer goes
+ * straight to the stream.
+ */
+
+void SentenceWriter::append(const char *text, size_t length)
+{
+  if (used + length > buffer.size()) {
+    drain();
+    if (length > buffer.size()) {
+      out.write(text, length);
+      return;
+    }
+  }
+  memcpy(&buffer[used], text, length);
+  used += length;
+}
+
+void SentenceWriter::drain()
+{
+  if (used > 0) out.write(&buffer[0], used);
+  used = 0;
+}
@@ -0,0 +1,107 @@
+#ifndef __sentencewriter__
+#define __sentencewriter__
+
+/**
+ * File: sentencewriter.h
+ * ----------------------
+ * Defines the SentenceWriter class, which lays out generated
+ * sentences the way the sample application does: each under a
+ * "Version #n" banner, words separated by single spaces (except
+ * that punctuation hugs the word before it), and lines wrapped
+ * before they grow past 55 characters.
+ *
+ * Words are copied straight into a reusable buffer as they're
+ * written, so a sentence never has to be collected before it's
+ * printed.  The buffer is only handed to the underlying stream
+ * when it fills up, when flush is called, or when the
+ * SentenceWriter is destroyed.
+ */
+
+#include <ostream>
+#include <vector>
+using namespace std;
+
+class SentenceWriter {
+
+ public:
+
+  /**
+   * Constructor: SentenceWriter
+   * ---------------------------
+   * Constructs a SentenceWriter that eventually writes everything
+   * to the specified stream, which must outlive it.
+   *
+   * @param out the stream receiving the formatted sentences.
+   * @param capacity the size of the buffer, in bytes.
+   */
+
+  SentenceWriter(ostream& out, size_t capacity = 64 * 1024);
+
+  /**
+   * Destructor: ~SentenceWriter
+   * ---------------------------
+   * Flushes whatever is still buffered.
+   */
+
+  ~SentenceWriter();
+
+  /**
+   * Method: beginSentence
+   * ---------------------
+   * Writes the banner introducing the sentence with the specified
+   * number, and the indentation of its first line.
+   */
+
+  void beginSentence(int number);
+
+  /**
+   * Method: write
+   * -------------
+   * Appends one word to the current sentence, preceded by a space
+   * unless it's punctuation or the first word on its line, and
+   * preceded by a line break instead if it would push the line
+   * past the wrap column.
+   */
+
+  void write(const char *word);
+
+  /**
+   * Method: endSentence
+   * -------------------
+   * Terminates the current sentence and the blank line after it.
+   */
+
+  void endSentence();
+
+  /**
+   * Method: flush
+   * -------------
+   * Hands everything buffered so far to the underlying stream,
+   * and flushes that stream.
+   */
+
+  void flush();
+
+  /**
+   * Function: hugsPreviousWord
+   * --------------------------
+   * Returns true if and only if the word is punctuation that's
+   * printed right up against the word before it, without a space.
+   */
+
+  static bool hugsPreviousWord(const char *word);
+
+ private:
+  SentenceWriter(const SentenceWriter& other) = delete;
+  SentenceWriter& operator=(const SentenceWriter& other) = delete;
+
+  void append(const char *text, size_t length);
+  void drain();
+
+  ostream& out;
+  vector<char> buffer;
+  size_t used;
+  size_t column;
+};
+
+#endif // ! __sentencewriter__
@@ -0,0 +1,461 @@
+/**
+ * File: server.cc
+ * ---------------
+ * Provides the implementation of the GrammarServer class.
+ *
+ * The thread that calls serve does all of the reading: it polls the
+ * listening socket and every open connection, accepts new connections,
+ * and splits whatever arrives into request lines, each of which becomes
+ * a Job tagged with its position on its connection.  The worker threads
+ * take Jobs off a shared queue and generate the responses.  A response
+ * that's ready before the ones ahead of it is parked on its Connection
+ * until they're written, so responses always leave in request order.
+ *
+ * Each worker builds its own Expander for each grammar the first time
+ * it needs one, and reseeds its own RandomGenerator for every request,
+ * so workers never share anything mutable but the queue and the
+ * Connections.  A Connection is closed once the client has hung up and
+ * the last of its Jobs has been answered.
+ */
+
+#include "server.h"
+#include "expander.h"
+#include "random.h"
+#include "sentencewriter.h"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+
+static const int kMaxSentencesPerRequest = 10000;
+static const size_t kReadSize = 64 * 1024;
+static const size_t kMaxRequestLength = 4096;
+static const int kSendTimeoutSeconds = 10;
+static const long kMaxJobsPerConnection = 16;
+static const long kMaxUnfinishedJobs = 64;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int)
+{
+  stopRequested = 1;
+}
+
+struct GrammarServer::Connection {
+  Connection(int fd) : fd(fd), numRequests(0), nextToSend(0), writing(false), broken(false) {}
+  ~Connection() { close(fd); }
+
+  int fd;
+  string input;                 // only touched by the serving thread
+  long numRequests;             // likewise
+  mutex lock;                   // guards everything below
+  long nextToSend;
+  map<long, string> finished;
+  bool writing;                 // some worker is writing responses, without the lock
+  bool broken;
+};
+
+struct GrammarServer::Job {
+  shared_ptr<Connection> connection;
+  long sequence;
+  string request;
+};
+
+/**
+ * Class: GrammarServer::JobQueue
+ * ------------------------------
+ * The queue of Jobs waiting for a worker.  Once it's closed, pop
+ * hands out whatever is left and then returns false.
+ *
+ * It also counts the Jobs that are unfinished, which is to say pushed
+ * but not yet written back to their client (or dropped, if the client
+ * is gone), since they're what holds on to memory.  The serving thread
+ * stops pushing once hasRoom says there are kMaxUnfinishedJobs of
+ * them, and workers report each batch they finish.  Every finish after
+ * the serving thread calls armWakeup writes a byte to wakeFd, so
+ * the serving thread's poll notices that there's room again.
+ */
+
+class GrammarServer::JobQueue {
+ public:
+  JobQueue(int wakeFd) : wakeFd(wakeFd), unfinished(0), armed(false), closed(false) {}
+
+  void push(Job& job) {
+    lock_guard<mutex> guard(lock);
+    jobs.push_back(std::move(job));
+    unfinished++;
+    ready.notify_one();
+  }
+
+  bool hasRoom() {
+    lock_guard<mutex> guard(lock);
+    return unfinished < kMaxUnfinishedJobs;
+  }
+
+  void armWakeup() {
+    lock_guard<mutex> guard(lock);
+    armed = true;
+  }
+
+  void finish(long count) {
+    lock_guard<mutex> guard(lock);
+    unfinished -= count;
+    if (armed) {
+      armed = false;
+      char byte = 0;
+      if (write(wakeFd, &byte, 1) < 0) {}    // a full pipe already holds a wakeup
+    }
+  }
+
+  bool pop(Job& job) {
+    unique_lock<mutex> guard(lock);
+    while (jobs.empty() && !closed) ready.wait(guard);
+    if (jobs.empty()) return false;
+    job = std::move(jobs.front());
+    jobs.pop_front();
+    return true;
+  }
+
+  void close() {
+    lock_guard<mutex> guard(lock);
+    closed = true;
+    ready.notify_all();
+  }
+
+ private:
+  mutex lock;
+  condition_variable ready;
+  deque<Job> jobs;
+  int wakeFd;
+  long unfinished;
+  bool armed;
+  bool closed;
+};
+
+GrammarServer::GrammarServer(int numWorkers) : numWorkers(numWorkers) {}
+
+bool GrammarServer::addGrammar(const string& filename, string& error)
+{
+  ifstream infile(filename.c_str());
+  if (infile.fail()) {
+    error = "The file can't be opened.";
+    return false;
+  }
+
+  unique_ptr<Grammar> grammar(new Grammar);
+  if (!readGrammar(infile, grammar->definitions, grammar->arena, error)) return false;
+  if (grammar->definitions.find("<start>") == grammar->definitions.end()) {
+    error = "There's no \"<start>\" in it.";
+    return false;
+  }
+  grammar->analysis.reset(new GrammarAnalysis(grammar->definitions));
+
+  string name = filename.substr(filename.find_last_of('/') + 1);
+  name = name.substr(0, name.find_last_of('.'));
+  grammars[name] = std::move(grammar);
+  return true;
+}
+
+/**
+ * Function: writeFully
+ * --------------------
+ * Writes all of the data to the socket, however many calls it takes.
+ * MSG_NOSIGNAL keeps a client that hangs up early from killing the
+ * whole server with a SIGPIPE, and the send timeout set on every
+ * accepted socket keeps one that stops reading from stalling it forever.
+ *
+ * @return false if the client can no longer be written to.
+ */
+
+static bool writeFully(int fd, const string& data)
+{
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t count = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    written += count;
+  }
+  return true;
+}
+
+/**
+ * Method: respond
+ * ---------------
+ * Parses a single request line and builds the full response to it.
+ * Expanders are cached in the map the worker passes in, keyed by
+ * grammar name, and they all draw from the worker's generator.
+ */
+
+string GrammarServer::respond(const string& request, map<string, unique_ptr<Expander> >& expanders,
+                              RandomGenerator& random)
+{
+  istringstream tokens(request);
+  string command, name, count, seed, extra;
+  tokens >> command >> name >> count >> seed;
+  if (command != "GEN" || seed.empty() || tokens >> extra) {
+    return "ERR expected GEN <grammar> <number of sentences> <seed>\n";
+  }
+
+  map<string, unique_ptr<Grammar> >::const_iterator found = grammars.find(name);
+  if (found == grammars.end()) return "ERR unknown grammar \"" + name + "\"\n";
+
+  char *end;
+  long numSentences = strtol(count.c_str(), &end, 10);
+  if (*end != '\0' || numSentences < 0 || numSentences > kMaxSentencesPerRequest) {
+    return "ERR the number of sentences must be between 0 and " + to_string(kMaxSentencesPerRequest) + "\n";
+  }
+  uint64_t value = strtoull(seed.c_str(), &end, 10);
+  if (*end != '\0' || seed[0] == '-') return "ERR the seed must be a non-negative integer\n";
+
+  unique_ptr<Expander>& expander = expanders[name];
+  if (!expander) expander.reset(new Expander(found->second->definitions, *found->second->analysis, random));
+
+  random.seed(value);
+  string response = "OK " + to_string(numSentences) + "\n";
+  vector<const char *> sentence;
+  for (long i = 0; i < numSentences; i++) {
+    sentence.clear();
+    expander->expand("<start>", sentence);
+    for (size_t j = 0; j < sentence.size(); j++) {
+      if (j > 0 && !SentenceWriter::hugsPreviousWord(sentence[j])) response += ' ';
+      response += sentence[j];
+    }
+    response += '\n';
+  }
+  return response;
+}
+
+/**
+ * Method: work
+ * ------------
+ * The body of every worker thread: answer Jobs until the queue is
+ * closed and drained.  Each response is parked on its Connection, and
+ * unless another worker is already writing to it, every parked response
+ * that's next in line is taken out and written.  The writes happen
+ * without the lock, so other workers can keep parking responses on
+ * the Connection meanwhile; the writer picks those up before it stops.
+ * A client that can't be written to is shut down, which also makes the
+ * serving thread stop reading requests from it.  Whoever takes responses
+ * out reports them to the queue as finished once they're written.
+ */
+
+void GrammarServer::work(JobQueue& queue)
+{
+  RandomGenerator random(0);
+  map<string, unique_ptr<Expander> > expanders;
+  Job job;
+  while (queue.pop(job)) {
+    string response = respond(job.request, expanders, random);
+    Connection& connection = *job.connection;
+    long numFinished = 0;
+    {
+      unique_lock<mutex> guard(connection.lock);
+      connection.finished[job.sequence] = std::move(response);
+      if (!connection.writing) {
+        connection.writing = true;
+        vector<string> ready;
+        while (true) {
+          map<long, string>::iterator next;
+          while ((next = connection.finished.find(connection.nextToSend)) != connection.finished.end()) {
+            if (!connection.broken) ready.push_back(std::move(next->second));
+            else numFinished++;
+            connection.finished.erase(next);
+            connection.nextToSend++;
+          }
+          if (ready.empty()) break;
+          guard.unlock();
+          numFinished += ready.size();
+          bool written = true;
+          for (size_t i = 0; written && i < ready.size(); i++) written = writeFully(connection.fd, ready[i]);
+          if (!written) shutdown(connection.fd, SHUT_RDWR);
+          ready.clear();
+          guard.lock();
+          if (!written) connection.broken = true;
+        }
+        connection.writing = false;
+      }
+    }
+    if (numFinished > 0) queue.finish(numFinished);
+    job.connection.reset();    // may close the Connection, so never while holding its lock
+  }
+}
+
+/**
+ * Method: dispatch
+ * ----------------
+ * Turns the complete request lines at the front of the connection's
+ * input into Jobs, for as long as neither the connection nor the queue
+ * has too many Jobs unfinished.  Any lines left over stay in the input,
+ * and the serving thread stops reading from the connection until they've
+ * been dispatched, so a client that pipelines requests faster than it
+ * reads the responses is simply left waiting on its socket.
+ */
+
+void GrammarServer::dispatch(const shared_ptr<Connection>& connection, JobQueue& queue)
+{
+  size_t start = 0, newline;
+  while ((newline = connection->input.find('\n', start)) != string::npos) {
+    long nextToSend;
+    {
+      lock_guard<mutex> guard(connection->lock);
+      nextToSend = connection->nextToSend;
+    }
+    if (connection->numRequests - nextToSend >= kMaxJobsPerConnection || !queue.hasRoom()) break;
+
+    string line = connection->input.substr(start, newline - start);
+    start = newline + 1;
+    if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+    if (line.find_first_not_of(" \t") == string::npos) continue;
+    Job job;
+    job.connection = connection;
+    job.sequence = connection->numRequests++;
+    job.request = line;
+    queue.push(job);
+  }
+  connection->input.erase(0, start);
+}
+
+/**
+ * Function: openSocket
+ * --------------------
+ * Creates, binds and listens on the Unix domain socket with the
+ * specified path.  A stale socket left behind by an earlier server is
+ * removed first, but nothing that isn't a socket ever is.
+ *
+ * @return the listening descriptor, or -1 on failure.
+ */
+
+static int openSocket(const string& socketPath)
+{
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) return -1;
+  strcpy(address.sun_path, socketPath.c_str());
+
+  struct stat info;
+  if (stat(socketPath.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) unlink(socketPath.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  if (bind(fd, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool GrammarServer::serve(const string& socketPath)
+{
+  int listener = openSocket(socketPath);
+  if (listener < 0) return false;
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = requestStop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  // SIGINT and SIGTERM stay blocked everywhere, workers included (they
+  // inherit the mask), except inside ppoll below, which unblocks them
+  // atomically while it waits.  So the signal always lands on this thread,
+  // and never between the check of stopRequested and the wait.
+  sigset_t stopSignals, originalMask, waitMask;
+  sigemptyset(&stopSignals);
+  sigaddset(&stopSignals, SIGINT);
+  sigaddset(&stopSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stopSignals, &originalMask);
+  waitMask = originalMask;
+  sigdelset(&waitMask, SIGINT);
+  sigdelset(&waitMask, SIGTERM);
+
+  int wakeup[2];
+  if (pipe2(wakeup, O_NONBLOCK | O_CLOEXEC) < 0) {
+    pthread_sigmask(SIG_SETMASK, &originalMask, NULL);
+    close(listener);
+    unlink(socketPath.c_str());
+    return false;
+  }
+
+  JobQueue queue(wakeup[1]);
+  vector<thread> workers;
+  for (int i = 0; i < numWorkers; i++) workers.push_back(thread(&GrammarServer::work, this, ref(queue)));
+
+  vector<shared_ptr<Connection> > connections;
+  vector<char> buffer(kReadSize);
+  while (!stopRequested) {
+    // Armed before the connections are looked at, so that any Job finished
+    // from here on wakes up the poll, and a connection held back below
+    // is looked at again as soon as there might be room for it.
+    queue.armWakeup();
+    vector<struct pollfd> fds(connections.size() + 2);
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeup[0];
+    fds[1].events = POLLIN;
+    for (size_t i = 0; i < connections.size(); i++) {
+      dispatch(connections[i], queue);
+      bool heldBack = connections[i]->input.find('\n') != string::npos;
+      fds[i + 2].fd = heldBack ? -1 : connections[i]->fd;     // poll ignores negative descriptors
+      fds[i + 2].events = POLLIN;
+    }
+    if (ppoll(&fds[0], fds.size(), NULL, &waitMask) < 0) continue;    // most likely interrupted by a signal
+    if (fds[1].revents & POLLIN) {
+      while (read(wakeup[0], &buffer[0], buffer.size()) > 0) {}
+    }
+
+    for (size_t i = connections.size(); i > 0; i--) {
+      if (fds[i + 1].revents == 0) continue;
+      shared_ptr<Connection> connection = connections[i - 1];
+      ssize_t count = read(connection->fd, &buffer[0], buffer.size());
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) {
+        connections.erase(connections.begin() + (i - 1));   // closed when its last Job is answered
+        continue;
+      }
+
+      connection->input.append(&buffer[0], count);
+      dispatch(connection, queue);
+      bool partial = connection->input.find('\n') == string::npos;
+      if (partial && connection->input.size() > kMaxRequestLength) {     // no request is anywhere near this long
+        shutdown(connection->fd, SHUT_RDWR);
+        connections.erase(connections.begin() + (i - 1));
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int fd = accept(listener, NULL, NULL);
+      if (fd >= 0) {
+        struct timeval timeout = { kSendTimeoutSeconds, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        connections.push_back(make_shared<Connection>(fd));
+      }
+    }
+  }
+
+  close(listener);
+  unlink(socketPath.c_str());
+  queue.close();
+  for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+  close(wakeup[0]);
+  close(wakeup[1]);
+  pthread_sigmask(SIG_SETMASK, &originalMask, NULL);
+  return true;
+}
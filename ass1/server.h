@@ -0,0 +1,103 @@
+#ifndef __server__
+#define __server__
+
+/**
+ * File: server.h
+ * --------------
+ * Defines the GrammarServer class, which loads grammars once and then
+ * generates sentences from them on request, over a Unix domain socket,
+ * for as long as it runs.  Every request is a single line:
+ *
+ *     GEN <grammar> <number of sentences> <seed>
+ *
+ * where <grammar> is the name of a grammar file without its directory
+ * or its extension (so data/excuse.g is "excuse").  The response is
+ * "OK <n>" on a line of its own, followed by the n sentences, one per
+ * line, or else a single line starting with "ERR" that explains what
+ * was wrong with the request.  A given grammar and seed always produce
+ * the same sentences, and they're the same sentences the command line
+ * prints for that seed.
+ *
+ * Requests are pipelined: a client may send any number of them without
+ * waiting for a response.  They're handed to a pool of worker threads
+ * and may well be handled out of order, but the responses on each
+ * connection always come back in the order the requests were sent.
+ * Only so many requests are ever outstanding, on each connection and
+ * across all of them; past that, the server stops reading requests
+ * until some of the responses have been written.  A client that sends
+ * more than a few kilobytes without a newline, or that stops reading
+ * its responses for long enough that a write to it times out, is
+ * disconnected.
+ */
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "definition.h"
+#include "grammaranalysis.h"
+using namespace std;
+
+class Expander;
+class RandomGenerator;
+
+class GrammarServer {
+
+ public:
+
+  /**
+   * Constructor: GrammarServer
+   * --------------------------
+   * Constructs a GrammarServer with no grammars, which will
+   * generate sentences on the specified number of threads.
+   */
+
+  GrammarServer(int numWorkers);
+
+  /**
+   * Method: addGrammar
+   * ------------------
+   * Reads the grammar file with the specified name, and makes it
+   * available under the name of the file sans directory and extension.
+   *
+   * @return false, with the reason in error, if the file can't be
+   *         opened, has a malformed weight or has no <start>.
+   */
+
+  bool addGrammar(const string& filename, string& error);
+
+  /**
+   * Method: serve
+   * -------------
+   * Listens on the Unix domain socket with the specified path and
+   * serves requests until the process is interrupted or terminated,
+   * at which point the socket file is removed again.
+   *
+   * @return false if the socket couldn't be set up.
+   */
+
+  bool serve(const string& socketPath);
+
+ private:
+  struct Grammar {
+    Arena arena;
+    map<string, Definition> definitions;
+    unique_ptr<GrammarAnalysis> analysis;
+  };
+
+  struct Connection;
+  struct Job;
+  class JobQueue;
+
+  GrammarServer(const GrammarServer& other) = delete;
+  GrammarServer& operator=(const GrammarServer& other) = delete;
+  string respond(const string& request, map<string, unique_ptr<Expander> >& expanders, RandomGenerator& random);
+  void work(JobQueue& queue);
+  void dispatch(const shared_ptr<Connection>& connection, JobQueue& queue);
+
+  int numWorkers;
+  map<string, unique_ptr<Grammar> > grammars;
+};
+
+#endif // ! __server__
@@ -0,0 +1,107 @@
+#include "concurrenthashset.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * An element's shard comes from its full hash code (the same one the
+ * shard's hashset computes) times kShardMixer.  The multiplier differs
+ * from the one the open-addressing engine uses to place elements, so the
+ * elements of each shard are still spread over all of its slots.  The
+ * hash code is handed on to the shard's hashset, so each operation calls
+ * hashfn just once.
+ */
+
+static const uint64_t kShardMixer = 0xc2b2ae3d27d4eb4full;
+
+static concurrenthashsetshard *ShardFor(const concurrenthashset *c, const void *elemAddr, int *hash)
+{
+	*hash = c->hashfn(elemAddr, INT_MAX);
+	assert(*hash >= 0 && *hash < INT_MAX);
+	return c->shards + (((uint64_t)*hash * kShardMixer) >> 32) % c->num_shards;
+}
+
+void ConcurrentHashSetNew(concurrenthashset *c, int elemSize, int numBuckets, int numShards,
+		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn)
+{
+	assert(numShards > 0);
+	assert(numBuckets > 0);
+	c->shards = malloc(numShards * sizeof(concurrenthashsetshard));
+	assert(c->shards != NULL);
+	c->num_shards = numShards;
+	c->hashfn = hashfn;
+	for (int i = 0; i < numShards; i++) {
+		pthread_rwlock_init(&c->shards[i].lock, NULL);
+		HashSetNewOpenAddressing(&c->shards[i].elems, elemSize, (numBuckets + numShards - 1) / numShards,
+				hashfn, comparefn, freefn);
+	}
+}
+
+void ConcurrentHashSetDispose(concurrenthashset *c)
+{
+	for (int i = 0; i < c->num_shards; i++) {
+		HashSetDispose(&c->shards[i].elems);
+		pthread_rwlock_destroy(&c->shards[i].lock);
+	}
+	free(c->shards);
+}
+
+int ConcurrentHashSetCount(concurrenthashset *c)
+{
+	int count = 0;
+	for (int i = 0; i < c->num_shards; i++) {
+		pthread_rwlock_rdlock(&c->shards[i].lock);
+		count += HashSetCount(&c->shards[i].elems);
+		pthread_rwlock_unlock(&c->shards[i].lock);
+	}
+	return count;
+}
+
+void ConcurrentHashSetEnter(concurrenthashset *c, const void *elemAddr)
+{
+	assert(elemAddr != NULL);
+	int hash;
+	concurrenthashsetshard *shard = ShardFor(c, elemAddr, &hash);
+	pthread_rwlock_wrlock(&shard->lock);
+	HashSetEnterHashed(&shard->elems, elemAddr, hash);
+	pthread_rwlock_unlock(&shard->lock);
+}
+
+void ConcurrentHashSetUpsert(concurrenthashset *c, const void *elemAddr,
+		ConcurrentHashSetUpsertFunction upsertfn, void *auxData)
+{
+	assert(elemAddr != NULL);
+	assert(upsertfn != NULL);
+	int hash;
+	concurrenthashsetshard *shard = ShardFor(c, elemAddr, &hash);
+	pthread_rwlock_wrlock(&shard->lock);
+	bool inserted;
+	void *found = HashSetFindOrInsertHashed(&shard->elems, elemAddr, hash, &inserted);
+	upsertfn(found, inserted, auxData);
+	pthread_rwlock_unlock(&shard->lock);
+}
+
+bool ConcurrentHashSetLookup(concurrenthashset *c, const void *elemAddr, void *copyAddr)
+{
+	assert(elemAddr != NULL);
+	assert(copyAddr != NULL);
+	int hash;
+	concurrenthashsetshard *shard = ShardFor(c, elemAddr, &hash);
+	pthread_rwlock_rdlock(&shard->lock);
+	void *found = HashSetLookupHashed(&shard->elems, elemAddr, hash);
+	if (found != NULL) memcpy(copyAddr, found, shard->elems.elem_size);
+	pthread_rwlock_unlock(&shard->lock);
+	return found != NULL;
+}
+
+void ConcurrentHashSetMap(concurrenthashset *c, HashSetMapFunction mapfn, void *auxData)
+{
+	assert(mapfn != NULL);
+	for (int i = 0; i < c->num_shards; i++) {
+		pthread_rwlock_wrlock(&c->shards[i].lock);
+		HashSetMap(&c->shards[i].elems, mapfn, auxData);
+		pthread_rwlock_unlock(&c->shards[i].lock);
+	}
+}
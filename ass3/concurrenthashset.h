@@ -0,0 +1,131 @@
+#ifndef _concurrenthashset_
+#define _concurrenthashset_
+#include "hashset.h"
+#include <pthread.h>
+
+/* File: concurrenthashset.h
+ * -------------------------
+ * Defines the interface for the concurrenthashset, a hashset that any
+ * number of threads may use at once.  The elements are split over a
+ * number of shards, each an ordinary open-addressing hashset with a
+ * reader-writer lock of its own, and an element's shard is picked from
+ * its hash code.  Lookups in a shard proceed in parallel, and so do
+ * updates to different shards, so several threads can, say, parse
+ * different parts of a corpus and feed a single word index.
+ *
+ * The hash, compare and free functions have exactly the same meaning
+ * as they do for the hashset, but they may be called from any thread.
+ */
+
+/**
+ * Type: ConcurrentHashSetUpsertFunction
+ * -------------------------------------
+ * Class of function passed to ConcurrentHashSetUpsert.  It's called
+ * on the element in the set that matches the one passed to the upsert,
+ * while no other thread can get at that element.  inserted is true if
+ * that element was only just entered (as a copy of the one passed to
+ * the upsert), and false if it was already there.  The function may
+ * change the element in any way that doesn't change its hash code or
+ * how it compares to other elements, and it must not call back into
+ * the concurrenthashset.
+ */
+
+typedef void (*ConcurrentHashSetUpsertFunction)(void *elemAddr, bool inserted, void *auxData);
+
+/**
+ * Type: concurrenthashset
+ * -----------------------
+ * The concrete representation of the concurrenthashset.  As with
+ * the hashset, clients should only ever go through the functions below.
+ */
+
+typedef struct {
+  pthread_rwlock_t lock;
+  hashset elems;
+} concurrenthashsetshard;
+
+typedef struct {
+  concurrenthashsetshard *shards;
+  int num_shards;
+  HashSetHashFunction hashfn;
+} concurrenthashset;
+
+/**
+ * Function: ConcurrentHashSetNew
+ * ------------------------------
+ * Initializes the identified concurrenthashset to be empty, with
+ * numShards shards that between them start out with room for about
+ * numBuckets elements.  A few times as many shards as there are threads
+ * keeps them from contending for the same lock very often.  The other
+ * parameters are as for HashSetNew.  An assert is raised if numShards
+ * is less than or equal to 0, and otherwise under the same conditions
+ * as HashSetNew.
+ */
+
+void ConcurrentHashSetNew(concurrenthashset *c, int elemSize, int numBuckets, int numShards,
+		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn);
+
+/**
+ * Function: ConcurrentHashSetDispose
+ * ----------------------------------
+ * Disposes of every shard, calling the free function on each element.
+ * No other thread may be using the concurrenthashset at the time.
+ */
+
+void ConcurrentHashSetDispose(concurrenthashset *c);
+
+/**
+ * Function: ConcurrentHashSetCount
+ * --------------------------------
+ * Returns the number of elements in the concurrenthashset.  While other
+ * threads are entering elements, the count is only a snapshot.
+ */
+
+int ConcurrentHashSetCount(concurrenthashset *c);
+
+/**
+ * Function: ConcurrentHashSetEnter
+ * --------------------------------
+ * Enters a copy of the element at elemAddr, replacing (and freeing)
+ * any matching element, just as HashSetEnter does.
+ */
+
+void ConcurrentHashSetEnter(concurrenthashset *c, const void *elemAddr);
+
+/**
+ * Function: ConcurrentHashSetUpsert
+ * ---------------------------------
+ * Looks for an element matching the one at elemAddr and enters a copy
+ * of the one at elemAddr if there isn't one, then calls upsertfn on the
+ * element in the set, all as one atomic step.  This is how several
+ * threads can safely update the same element, as with adding to the
+ * count of a word two threads come across at once.
+ */
+
+void ConcurrentHashSetUpsert(concurrenthashset *c, const void *elemAddr,
+		ConcurrentHashSetUpsertFunction upsertfn, void *auxData);
+
+/**
+ * Function: ConcurrentHashSetLookup
+ * ---------------------------------
+ * Looks for an element matching the one at elemAddr, and if there is
+ * one, copies it to copyAddr.  The copy is taken while the element is
+ * protected, which is why there's no way to get at the element itself:
+ * another thread could be changing it the moment the lock is released.
+ *
+ * @return true if and only if a matching element was found.
+ */
+
+bool ConcurrentHashSetLookup(concurrenthashset *c, const void *elemAddr, void *copyAddr);
+
+/**
+ * Function: ConcurrentHashSetMap
+ * ------------------------------
+ * Applies mapfn to every element, one shard at a time, holding each
+ * shard's lock while mapfn works through it.  mapfn must not call back
+ * into the concurrenthashset.
+ */
+
+void ConcurrentHashSetMap(concurrenthashset *c, HashSetMapFunction mapfn, void *auxData);
+
+#endif
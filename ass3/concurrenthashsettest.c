@@ -0,0 +1,157 @@
+#include "concurrenthashset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define kNumThreads 8
+static const int kNumShards = 32;
+
+struct wordcount {
+  char word[32];	// a word, in lowercase
+  int occurrences;	// the number of times it occurs
+};
+
+static long numHashes;	// calls to HashWord, from every thread
+
+/**
+ * Function: HashWord
+ * ------------------
+ * Hash function for wordcount structures, hashing the word alone.
+ * It counts its calls, so the test can check that every operation
+ * hashes its element just once.
+ */
+
+static int HashWord(const void *elem, int numBuckets)
+{
+  __sync_fetch_and_add(&numHashes, 1);
+  const char *s = ((const struct wordcount *)elem)->word;
+  unsigned long hashcode = 0;
+  for (; *s != '\0'; s++) hashcode = hashcode * -1664117991L + *s;
+  return hashcode % numBuckets;
+}
+
+static int CompareWord(const void *elem1, const void *elem2)
+{
+  return strcmp(((const struct wordcount *)elem1)->word, ((const struct wordcount *)elem2)->word);
+}
+
+/**
+ * Function: AddOccurrence
+ * -----------------------
+ * Upsert function that counts one more occurrence of a word.  A
+ * freshly entered wordcount was copied with an occurrences of 0.
+ */
+
+static void AddOccurrence(void *elem, bool inserted, void *unused)
+{
+  ((struct wordcount *)elem)->occurrences++;
+}
+
+/**
+ * Function: ReadWords
+ * -------------------
+ * Reads every word (every maximal run of letters) out of this very
+ * file, lowercased, into the vector of wordcounts passed in.
+ */
+
+static void ReadWords(vector *words)
+{
+  struct wordcount word = { "", 0 };
+  int length = 0, ch;
+  FILE *fp = fopen("concurrenthashsettest.c", "r"); // open self as file
+
+  assert(fp != NULL);
+  while ((ch = getc(fp)) != EOF) {
+    if (isalpha(ch) && length < sizeof(word.word) - 1) {
+      word.word[length++] = tolower(ch);
+    } else if (length > 0) {
+      word.word[length] = '\0';
+      VectorAppend(words, &word);
+      length = 0;
+    }
+  }
+  fclose(fp);
+}
+
+struct worker {
+  concurrenthashset *counts;
+  const vector *words;
+  int first;
+};
+
+/**
+ * Function: CountWords
+ * --------------------
+ * Thread routine that counts every kNumThreads-th word, starting with
+ * the worker's first, into the shared concurrenthashset.  The whole
+ * word list is counted ten times over, so the threads collide often.
+ */
+
+static void *CountWords(void *data)
+{
+  struct worker *worker = data;
+  for (int round = 0; round < 10; round++) {
+    for (int i = worker->first; i < VectorLength(worker->words); i += kNumThreads)
+      ConcurrentHashSetUpsert(worker->counts, VectorNth(worker->words, i), AddOccurrence, NULL);
+  }
+  return NULL;
+}
+
+static void CheckCount(void *elem, void *expected)
+{
+  struct wordcount *found = elem, reference;
+  assert(ConcurrentHashSetLookup(expected, elem, &reference));
+  assert(found->occurrences == reference.occurrences * 10);
+}
+
+/**
+ * Function: TestConcurrentCounts
+ * ------------------------------
+ * Counts the words of this file on a single thread, and then again on
+ * kNumThreads threads at once, and checks that the two agree exactly.
+ */
+
+static void TestConcurrentCounts(void)
+{
+  concurrenthashset expected, counts;
+  vector words;
+  pthread_t threads[kNumThreads];
+  struct worker workers[kNumThreads];
+
+  fprintf(stdout, "\n\n ------------------------- Starting the concurrent hashset test\n");
+  VectorNew(&words, sizeof(struct wordcount), NULL, 0);
+  ReadWords(&words);
+
+  ConcurrentHashSetNew(&expected, sizeof(struct wordcount), 64, 1, HashWord, CompareWord, NULL);
+  for (int i = 0; i < VectorLength(&words); i++)
+    ConcurrentHashSetUpsert(&expected, VectorNth(&words, i), AddOccurrence, NULL);
+
+  ConcurrentHashSetNew(&counts, sizeof(struct wordcount), 64, kNumShards, HashWord, CompareWord, NULL);
+  numHashes = 0;
+  for (int i = 0; i < kNumThreads; i++) {
+    workers[i].counts = &counts;
+    workers[i].words = &words;
+    workers[i].first = i;
+    pthread_create(&threads[i], NULL, CountWords, &workers[i]);
+  }
+  for (int i = 0; i < kNumThreads; i++) pthread_join(threads[i], NULL);
+  assert(numHashes == 10L * VectorLength(&words));
+
+  assert(ConcurrentHashSetCount(&counts) == ConcurrentHashSetCount(&expected));
+  ConcurrentHashSetMap(&counts, CheckCount, &expected);
+  fprintf(stdout, "%d threads counted %d words, %d of them distinct, and agree with a single thread.\n",
+	  kNumThreads, 10 * VectorLength(&words), ConcurrentHashSetCount(&counts));
+
+  VectorDispose(&words);
+  ConcurrentHashSetDispose(&expected);
+  ConcurrentHashSetDispose(&counts);
+}
+
+int main(int ununsed, char **alsoUnused)
+{
+  TestConcurrentCounts();
+  return 0;
+}
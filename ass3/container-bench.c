@@ -0,0 +1,170 @@
+/**
+ * File: container-bench.c
+ * -----------------------
+ * Micro-benchmark comparing the generic vector and hashset against the
+ * typed flavors generated by typedvector.h and typedhashset.h, on the
+ * kinds of work vectortest.c, hashsettest.c and the thesaurus do:
+ * appending and reading back small elements, counting occurrences of
+ * small structs keyed by a char, and looking up words by their char *.
+ * Both sides of each comparison share their layout, their probing and
+ * their hash function, so the differences come from inlining alone.
+ *
+ *     ./container-bench [number of operations]
+ */
+
+#include "hashset.h"
+#include "typedhashset.h"
+#include "typedvector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const int kDefaultNumOperations = 10000000;
+static const int kNumWords = 50000;
+
+struct frequency {
+  char ch;
+  int occurrences;
+};
+
+static double Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void Report(const char *name, int numOperations, double seconds, long checksum)
+{
+  printf("%-34s %8.2f ns/op %10.1f M ops/s   (checksum %ld)\n",
+	 name, seconds * 1e9 / numOperations, numOperations / seconds / 1e6, checksum);
+}
+
+static inline unsigned FrequencyHash(const struct frequency *freq)
+{ return (unsigned char)freq->ch; }
+
+static inline bool FrequencyEqual(const struct frequency *freq1, const struct frequency *freq2)
+{ return freq1->ch == freq2->ch; }
+
+static inline unsigned WordHash(char *const *word)
+{
+  unsigned long hashcode = 0;
+  for (const char *s = *word; *s != '\0'; s++) hashcode = hashcode * -1664117991L + *s;
+  return hashcode;
+}
+
+static inline bool WordEqual(char *const *word1, char *const *word2)
+{ return strcmp(*word1, *word2) == 0; }
+
+DEFINE_TYPED_VECTOR(intvector, int)
+DEFINE_TYPED_HASHSET(frequencyset, struct frequency, FrequencyHash, FrequencyEqual)
+DEFINE_TYPED_HASHSET(wordset, char *, WordHash, WordEqual)
+
+static int HashFrequency(const void *elem, int numBuckets)
+{ return FrequencyHash(elem) % (unsigned)numBuckets; }
+
+static int CompareFrequency(const void *elem1, const void *elem2)
+{ return ((const struct frequency *)elem1)->ch - ((const struct frequency *)elem2)->ch; }
+
+static int HashWord(const void *elem, int numBuckets)
+{ return WordHash(elem) % (unsigned)numBuckets; }
+
+static int CompareWord(const void *elem1, const void *elem2)
+{ return strcmp(*(char **)elem1, *(char **)elem2); }
+
+static void BenchmarkVectors(int numOperations)
+{
+  vector generic;
+  intvector typed;
+  long checksum = 0;
+
+  double start = Now();
+  VectorNew(&generic, sizeof(int), NULL, 0);
+  for (int i = 0; i < numOperations; i++) VectorAppend(&generic, &i);
+  for (int i = 0; i < numOperations; i++) checksum += *(int *)VectorNth(&generic, i);
+  VectorDispose(&generic);
+  Report("vector append + nth", numOperations, Now() - start, checksum);
+
+  checksum = 0;
+  start = Now();
+  intvectorNew(&typed, NULL, 0);
+  for (int i = 0; i < numOperations; i++) intvectorAppend(&typed, i);
+  for (int i = 0; i < numOperations; i++) checksum += *intvectorNth(&typed, i);
+  intvectorDispose(&typed);
+  Report("typed vector append + nth", numOperations, Now() - start, checksum);
+}
+
+static void BenchmarkLetterCounts(int numOperations)
+{
+  hashset generic;
+  frequencyset typed;
+  struct frequency freq = { 0, 0 };
+  long checksum = 0;
+
+  double start = Now();
+  HashSetNewOpenAddressing(&generic, sizeof(struct frequency), 26, HashFrequency, CompareFrequency, NULL);
+  for (int i = 0; i < numOperations; i++) {
+    freq.ch = 'a' + i % 26;
+    checksum += ++((struct frequency *)HashSetFindOrInsert(&generic, &freq, NULL))->occurrences;
+  }
+  HashSetDispose(&generic);
+  Report("hashset letter counts", numOperations, Now() - start, checksum);
+
+  checksum = 0;
+  start = Now();
+  frequencysetNew(&typed, 26, NULL);
+  for (int i = 0; i < numOperations; i++) {
+    freq.ch = 'a' + i % 26;
+    checksum += ++frequencysetFindOrInsert(&typed, &freq, NULL)->occurrences;
+  }
+  frequencysetDispose(&typed);
+  Report("typed hashset letter counts", numOperations, Now() - start, checksum);
+}
+
+static void BenchmarkWordLookups(int numOperations, char **words)
+{
+  hashset generic;
+  wordset typed;
+  long checksum = 0;
+
+  HashSetNewOpenAddressing(&generic, sizeof(char *), kNumWords, HashWord, CompareWord, NULL);
+  for (int i = 0; i < kNumWords; i++) HashSetEnter(&generic, &words[i]);
+  double start = Now();
+  for (int i = 0; i < numOperations; i++) checksum += HashSetLookup(&generic, &words[i % (2 * kNumWords)]) != NULL;
+  Report("hashset word lookups", numOperations, Now() - start, checksum);
+  HashSetDispose(&generic);
+
+  checksum = 0;
+  wordsetNew(&typed, kNumWords, NULL);
+  for (int i = 0; i < kNumWords; i++) wordsetEnter(&typed, &words[i]);
+  start = Now();
+  for (int i = 0; i < numOperations; i++) checksum += wordsetLookup(&typed, &words[i % (2 * kNumWords)]) != NULL;
+  Report("typed hashset word lookups", numOperations, Now() - start, checksum);
+  wordsetDispose(&typed);
+}
+
+int main(int argc, char *argv[])
+{
+  int numOperations = (argc > 1) ? atoi(argv[1]) : kDefaultNumOperations;
+  if (numOperations <= 0) {
+    fprintf(stderr, "Usage: container-bench [number of operations]\n");
+    return 1;
+  }
+
+  char **words = malloc(2 * kNumWords * sizeof(char *));   // only the first half are entered
+  for (int i = 0; i < 2 * kNumWords; i++) {
+    char word[32];
+    sprintf(word, "word%d", i * 7919);
+    words[i] = strdup(word);
+  }
+
+  printf("Running %d operations of each kind.\n", numOperations);
+  BenchmarkVectors(numOperations);
+  BenchmarkLetterCounts(numOperations);
+  BenchmarkWordLookups(numOperations, words);
+
+  for (int i = 0; i < 2 * kNumWords; i++) free(words[i]);
+  free(words);
+  return 0;
+}
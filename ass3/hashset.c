@@ -1,8 +1,163 @@
 #include "hashset.h"
+#include "hashsetgroup.h"
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * Every bucket is a vector of slots.  A slot is the element's full hash
+ * code (what hashfn returns when asked to spread elements over kHashRange
+ * buckets), padded out to kSlotHeaderSize bytes so the element after it
+ * stays aligned, followed by the element itself.  The bucket an element
+ * lives in is its full hash code modulo num_buckets, so growing the table
+ * never needs to call hashfn again, and a chain search only calls
+ * comparefn on elements whose full hash codes match.
+ *
+ * The bucket array is calloc'ed, and a bucket stays all zeros (with an
+ * elem_size of 0, which VectorNew never leaves behind, and a length of 0)
+ * until the first element lands in it, so empty buckets cost nothing
+ * beyond their sizeof(vector).
+ */
+
+static const int kHashRange = INT_MAX;
+static const double kDefaultMaxLoadFactor = 2.0;
+#define kSlotHeaderSize 8
+
+/*
+ * Open-addressing hashsets (those created by HashSetNewOpenAddressing)
+ * have no buckets.  Elements sit inline in one array of capacity slots,
+ * with their full hash codes in a parallel array, and one control byte
+ * per slot says whether the slot is empty (kHashSetEmpty) or else holds
+ * a seven bit tag drawn from the full hash code of its element.  The
+ * slots are divided into groups of kHashSetGroupWidth, and an element's
+ * probe sequence visits whole groups, starting at a group also drawn from
+ * its hash code and moving 1, 2, 3, ... groups further along at each
+ * step.  With a power-of-two number of groups, that visits every group.
+ * Client hash functions are often weak in their low bits, so the tag and
+ * the first group are both taken from high bits of the hash code times
+ * kHashSetMixer.  The primitives live in hashsetgroup.h.
+ *
+ * A whole group's control bytes are compared against a tag at once (with
+ * a single SSE2 compare where that's available), and only slots whose tag
+ * matches are looked at any further, so most misses never call comparefn
+ * at all.  Nothing is ever removed, so the first group with an empty slot
+ * ends every search.  The table doubles before it's more than 7/8 full,
+ * so there always is such a group.
+ */
+
+static void *SlotElem(const void *slot)
+{ return (char *)slot + kSlotHeaderSize; }
+
+static int SlotHash(const void *slot)
+{ return *(const int *)slot; }
+
+static void NewBuckets(hashset *h, int numBuckets)
+{
+	h->num_buckets = numBuckets;
+	h->buckets = (vector*)calloc(numBuckets, sizeof(vector));
+	assert(h->buckets != NULL);
+}
+
+static bool BucketAllocated(const vector *v)
+{ return v->elem_size != 0; }
+
+static void BucketAppend(const hashset *h, vector *v, const void *slot)
+{
+	if (!BucketAllocated(v)) VectorNew(v, h->slot_size, NULL, 0);
+	VectorAppend(v, slot);
+}
+
+static void *OpenSlot(const hashset *h, int index)
+{ return (char *)h->slots + index * h->elem_size; }
+
+static void NewSlots(hashset *h, int capacity)
+{
+	h->capacity = capacity;
+	h->ctrl = malloc(capacity);
+	h->slots = malloc((size_t)capacity * h->elem_size);
+	h->hashes = malloc(capacity * sizeof(int));
+	assert(h->ctrl != NULL && h->slots != NULL && h->hashes != NULL);
+	memset(h->ctrl, kHashSetEmpty, capacity);
+}
+
+/*
+ * Returns the index of the slot holding an element equal to elemAddr,
+ * or -1 if there isn't one.
+ */
+
+static int OpenFind(const hashset *h, const void *elemAddr, int hash)
+{
+	unsigned char tag = HashSetTag(hash);
+	for (int group = HashSetFirstGroup(h->capacity, hash), step = 1; ;
+			group = HashSetNextGroup(h->capacity, group, step++)) {
+		const unsigned char *ctrl = h->ctrl + group * kHashSetGroupWidth;
+		for (unsigned match = HashSetGroupMatch(ctrl, tag); match != 0; match &= match - 1) {
+			int index = group * kHashSetGroupWidth + __builtin_ctz(match);
+			if (h->hashes[index] == hash && h->comparefn(elemAddr, OpenSlot(h, index)) == 0) return index;
+		}
+		if (HashSetGroupMatch(ctrl, kHashSetEmpty) != 0) return -1;
+	}
+}
+
+/*
+ * Returns the index of the first empty slot along the probe
+ * sequence for the specified hash code.
+ */
+
+static int OpenFindEmpty(const hashset *h, int hash)
+{
+	for (int group = HashSetFirstGroup(h->capacity, hash), step = 1; ;
+			group = HashSetNextGroup(h->capacity, group, step++)) {
+		unsigned empty = HashSetGroupMatch(h->ctrl + group * kHashSetGroupWidth, kHashSetEmpty);
+		if (empty != 0) return group * kHashSetGroupWidth + __builtin_ctz(empty);
+	}
+}
+
+static void OpenPlace(hashset *h, int index, const void *elemAddr, int hash)
+{
+	h->ctrl[index] = HashSetTag(hash);
+	h->hashes[index] = hash;
+	memcpy(OpenSlot(h, index), elemAddr, h->elem_size);
+}
+
+static void OpenRehash(hashset *h, int capacity)
+{
+	unsigned char *oldCtrl = h->ctrl;
+	void *oldSlots = h->slots;
+	int *oldHashes = h->hashes;
+	int oldCapacity = h->capacity;
+	NewSlots(h, capacity);
+	for (int i = 0; i < oldCapacity; i++) {
+		if (oldCtrl[i] == kHashSetEmpty) continue;
+		OpenPlace(h, OpenFindEmpty(h, oldHashes[i]), (char *)oldSlots + i * h->elem_size, oldHashes[i]);
+	}
+	free(oldCtrl);
+	free(oldSlots);
+	free(oldHashes);
+}
+
+void HashSetNewOpenAddressing(hashset *h, int elemSize, int numBuckets,
+		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn)
+{
+	assert(elemSize > 0);
+	assert(numBuckets > 0);
+	assert(hashfn != NULL);
+	assert(comparefn != NULL);
+	h->buckets = NULL;
+	h->elem_size = elemSize;
+	h->slot_size = elemSize;
+	h->num_buckets = 0;
+	h->num_elems = 0;
+	h->max_load_factor = 0;
+	h->freefn = freefn;
+	h->comparefn = comparefn;
+	h->hashfn = hashfn;
+	int capacity = kHashSetGroupWidth;
+	while (capacity < numBuckets + numBuckets / 7 && capacity < (1 << 30)) capacity *= 2;
+	NewSlots(h, capacity);
+}
+
 void HashSetNew(hashset *h, int elemSize, int numBuckets,
 		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn)
 {
@@ -11,24 +166,37 @@ void HashSetNew(hashset *h, int elemSize, int numBuckets,
 	assert(hashfn != NULL);
 	assert(comparefn != NULL);
 	h->elem_size = elemSize;
-	h->num_buckets = numBuckets;
+	h->slot_size = kSlotHeaderSize + (elemSize + kSlotHeaderSize - 1) / kSlotHeaderSize * kSlotHeaderSize;
 	h->num_elems = 0;
+	h->max_load_factor = kDefaultMaxLoadFactor;
 	h->freefn = freefn;
 	h->comparefn = comparefn;
 	h->hashfn = hashfn;
-	h->buckets = (vector*)malloc(numBuckets * sizeof(vector));
-	assert(h->buckets != NULL);
-	for (int i = 0; i < numBuckets; i++) {
-		VectorNew(h->buckets + i, elemSize, freefn, 0);
-	}
+	h->ctrl = NULL;
+	h->slots = NULL;
+	h->hashes = NULL;
+	h->capacity = 0;
+	NewBuckets(h, numBuckets);
 }
 
 void HashSetDispose(hashset *h)
 {
-	if (h->freefn != NULL) {
-		for (int i = 0; i < h->num_buckets; i++) {
-			VectorDispose(h->buckets + i);
+	if (h->ctrl != NULL) {
+		for (int i = 0; i < h->capacity; i++) {
+			if (h->ctrl[i] != kHashSetEmpty && h->freefn != NULL) h->freefn(OpenSlot(h, i));
 		}
+		free(h->ctrl);
+		free(h->slots);
+		free(h->hashes);
+		return;
+	}
+	for (int i = 0; i < h->num_buckets; i++) {
+		vector *v = h->buckets + i;
+		if (!BucketAllocated(v)) continue;
+		if (h->freefn != NULL) {
+			for (int j = 0; j < VectorLength(v); j++) h->freefn(SlotElem(VectorNth(v, j)));
+		}
+		VectorDispose(v);
 	}
 	free(h->buckets);
 }
@@ -36,39 +204,294 @@ void HashSetDispose(hashset *h)
 int HashSetCount(const hashset *h)
 { return h->num_elems; }
 
+void HashSetSetMaxLoadFactor(hashset *h, double maxLoadFactor)
+{
+	assert(maxLoadFactor >= 0);
+	h->max_load_factor = maxLoadFactor;
+}
+
 void HashSetMap(hashset *h, HashSetMapFunction mapfn, void *auxData)
 {
 	assert(mapfn != NULL);
+	if (h->ctrl != NULL) {
+		for (int i = 0; i < h->capacity; i++) {
+			if (h->ctrl[i] != kHashSetEmpty) mapfn(OpenSlot(h, i), auxData);
+		}
+		return;
+	}
 	for (int i = 0; i < h->num_buckets; i++) {
-		VectorMap(h->buckets + i, mapfn, auxData);
+		vector *v = h->buckets + i;
+		for (int j = 0; j < VectorLength(v); j++) mapfn(SlotElem(VectorNth(v, j)), auxData);
 	}
 }
 
-void HashSetEnter(hashset *h, const void *elemAddr)
+/*
+ * HashSetMapParallel and HashSetMapReduce hand each task a range of
+ * buckets, or of slots, and otherwise work just like their vector
+ * counterparts, down to the padding between partial results.
+ */
+
+#define kCacheLineSize 64
+
+typedef struct {
+	hashset *h;
+	HashSetMapFunction mapfn;
+	HashSetAccumulateFunction accumulatefn;
+	void *aux_data;
+	int num_tasks;
+	char *partials;
+	int partial_size;
+} maptask;
+
+static void MapElem(const maptask *m, int task, void *elemAddr)
+{
+	if (m->mapfn != NULL) m->mapfn(elemAddr, m->aux_data);
+	else m->accumulatefn(elemAddr, m->partials + task * m->partial_size, m->aux_data);
+}
+
+static void MapRange(int task, void *data)
+{
+	maptask *m = data;
+	hashset *h = m->h;
+	int start, end;
+	if (h->ctrl != NULL) {
+		ThreadPoolTaskRange(task, m->num_tasks, h->capacity, &start, &end);
+		for (int i = start; i < end; i++) {
+			if (h->ctrl[i] != kHashSetEmpty) MapElem(m, task, OpenSlot(h, i));
+		}
+		return;
+	}
+	ThreadPoolTaskRange(task, m->num_tasks, h->num_buckets, &start, &end);
+	for (int i = start; i < end; i++) {
+		vector *v = h->buckets + i;
+		for (int j = 0; j < VectorLength(v); j++) MapElem(m, task, SlotElem(VectorNth(v, j)));
+	}
+}
+
+static int NumBucketsOrSlots(const hashset *h)
+{ return (h->ctrl != NULL) ? h->capacity : h->num_buckets; }
+
+void HashSetMapParallel(hashset *h, HashSetMapFunction mapfn, void *auxData, threadpool *pool)
+{
+	assert(mapfn != NULL);
+	assert(pool != NULL);
+	maptask m = { h, mapfn, NULL, auxData, ThreadPoolNumTasks(pool, NumBucketsOrSlots(h)), NULL, 0 };
+	ThreadPoolRun(pool, m.num_tasks, MapRange, &m);
+}
+
+void HashSetMapReduce(hashset *h, HashSetAccumulateFunction accumulatefn, HashSetCombineFunction combinefn,
+		      void *resultAddr, int resultSize, void *auxData, threadpool *pool)
+{
+	assert(accumulatefn != NULL && combinefn != NULL);
+	assert(resultAddr != NULL && resultSize > 0);
+	assert(pool != NULL);
+	int stride = (resultSize + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+	maptask m = { h, NULL, accumulatefn, auxData, ThreadPoolNumTasks(pool, NumBucketsOrSlots(h)), NULL, stride };
+	m.partials = malloc((size_t)m.num_tasks * stride);
+	assert(m.partials != NULL);
+	for (int i = 0; i < m.num_tasks; i++) memcpy(m.partials + i * stride, resultAddr, resultSize);
+	ThreadPoolRun(pool, m.num_tasks, MapRange, &m);
+	for (int i = 0; i < m.num_tasks; i++) combinefn(resultAddr, m.partials + i * stride, auxData);
+	free(m.partials);
+}
+
+static int FullHash(const hashset *h, const void *elemAddr)
+{
+	int hash = h->hashfn(elemAddr, kHashRange);
+	assert(hash >= 0 && hash < kHashRange);
+	return hash;
+}
+
+static int FindSlot(const hashset *h, const vector *v, const void *elemAddr, int hash)
+{
+	for (int i = 0; i < VectorLength(v); i++) {
+		void *slot = VectorNth(v, i);
+		if (SlotHash(slot) == hash && h->comparefn(elemAddr, SlotElem(slot)) == 0) return i;
+	}
+	return -1;
+}
+
+/*
+ * Moves every slot into a freshly allocated array of buckets, using the
+ * full hash codes already stored in the slots.
+ */
+
+static void Rehash(hashset *h, int numBuckets)
+{
+	vector *oldBuckets = h->buckets;
+	int oldNumBuckets = h->num_buckets;
+	NewBuckets(h, numBuckets);
+	for (int i = 0; i < oldNumBuckets; i++) {
+		vector *v = oldBuckets + i;
+		for (int j = 0; j < VectorLength(v); j++) {
+			void *slot = VectorNth(v, j);
+			BucketAppend(h, h->buckets + SlotHash(slot) % numBuckets, slot);
+		}
+		if (BucketAllocated(v)) VectorDispose(v);
+	}
+	free(oldBuckets);
+}
+
+void *HashSetFindOrInsert(hashset *h, const void *elemAddr, bool *inserted)
 {
 	assert(elemAddr != NULL);
-	int bucket_index = h->hashfn(elemAddr, h->num_buckets);
-	assert(bucket_index >= 0 && bucket_index < h->num_buckets);
-	
-	vector* v = h->buckets + bucket_index;
-	int index = VectorSearch(v, elemAddr, h->comparefn, 0, false);
-	
-
-	if (index == -1) {
-		VectorAppend(v, elemAddr);
+	return HashSetFindOrInsertHashed(h, elemAddr, FullHash(h, elemAddr), inserted);
+}
+
+void *HashSetFindOrInsertHashed(hashset *h, const void *elemAddr, int hash, bool *inserted)
+{
+	assert(elemAddr != NULL);
+	assert(hash >= 0 && hash < kHashRange);
+	if (inserted != NULL) *inserted = false;
+	if (h->ctrl != NULL) {
+		int found = OpenFind(h, elemAddr, hash);
+		if (found != -1) return OpenSlot(h, found);
+		if (HashSetMustGrow(h->num_elems, h->capacity)) OpenRehash(h, 2 * h->capacity);
+		found = OpenFindEmpty(h, hash);
+		OpenPlace(h, found, elemAddr, hash);
 		h->num_elems++;
-	} else {
-		VectorReplace(v, elemAddr, index);
+		if (inserted != NULL) *inserted = true;
+		return OpenSlot(h, found);
+	}
+
+	vector* v = h->buckets + hash % h->num_buckets;
+	int index = FindSlot(h, v, elemAddr, hash);
+	if (index != -1) return SlotElem(VectorNth(v, index));
+
+	if (h->max_load_factor > 0 && h->num_elems + 1 > h->max_load_factor * h->num_buckets) {
+		Rehash(h, 2 * h->num_buckets + 1);
+		v = h->buckets + hash % h->num_buckets;
 	}
+	char slot[h->slot_size];
+	memset(slot, 0, kSlotHeaderSize);
+	memcpy(slot, &hash, sizeof(hash));
+	memcpy(SlotElem(slot), elemAddr, h->elem_size);
+	BucketAppend(h, v, slot);
+	h->num_elems++;
+	if (inserted != NULL) *inserted = true;
+	return SlotElem(VectorNth(v, VectorLength(v) - 1));
+}
+
+void HashSetEnter(hashset *h, const void *elemAddr)
+{
+	assert(elemAddr != NULL);
+	HashSetEnterHashed(h, elemAddr, FullHash(h, elemAddr));
+}
+
+void HashSetEnterHashed(hashset *h, const void *elemAddr, int hash)
+{
+	bool inserted;
+	void *elem = HashSetFindOrInsertHashed(h, elemAddr, hash, &inserted);
+	if (inserted) return;
+	if (h->freefn != NULL) h->freefn(elem);
+	memcpy(elem, elemAddr, h->elem_size);
 }
 
 void *HashSetLookup(const hashset *h, const void *elemAddr)
 { 
 	assert(elemAddr != NULL);
-	int bucket_index = h->hashfn(elemAddr, h->num_buckets);
-	assert(bucket_index >= 0 && bucket_index < h->num_buckets);
+	return HashSetLookupHashed(h, elemAddr, FullHash(h, elemAddr));
+}
+
+void *HashSetLookupHashed(const hashset *h, const void *elemAddr, int hash)
+{
+	assert(elemAddr != NULL);
+	assert(hash >= 0 && hash < kHashRange);
+	if (h->ctrl != NULL) {
+		int found = OpenFind(h, elemAddr, hash);
+		return found == -1 ? NULL : OpenSlot(h, found);
+	}
+
+	vector* v = h->buckets + hash % h->num_buckets;
+	int index = FindSlot(h, v, elemAddr, hash);
+	return index == -1 ? NULL : SlotElem(VectorNth(v, index));
+}
+
+/*
+ * Returns the number of groups a lookup of the element in the
+ * specified slot probes, the slot's own group included.
+ */
+
+static int OpenProbeLength(const hashset *h, int index)
+{
+	int target = index / kHashSetGroupWidth, length = 1;
+	for (int group = HashSetFirstGroup(h->capacity, h->hashes[index]), step = 1; group != target;
+			group = HashSetNextGroup(h->capacity, group, step++)) {
+		length++;
+	}
+	return length;
+}
 
-	vector* v = h->buckets + bucket_index;
-	int index = VectorSearch(v, elemAddr, h->comparefn, 0, false);
-	return index == -1 ? NULL : VectorNth(v, index);
+static void RecordChain(hashsetstats *stats, int length)
+{
+	stats->chain_lengths[length < kHashSetStatsMaxChain ? length : kHashSetStatsMaxChain]++;
+	if (length > stats->max_chain) stats->max_chain = length;
+}
+
+void HashSetStats(const hashset *h, hashsetstats *stats)
+{
+	assert(stats != NULL);
+	memset(stats, 0, sizeof(*stats));
+	stats->num_elems = h->num_elems;
+	long totalChain = 0;
+	int numChains = 0;
+
+	if (h->ctrl != NULL) {
+		stats->num_buckets = h->capacity;
+		for (int i = 0; i < h->capacity; i++) {
+			if (h->ctrl[i] == kHashSetEmpty) {
+				stats->num_empty_buckets++;
+				continue;
+			}
+			int length = OpenProbeLength(h, i);
+			RecordChain(stats, length);
+			totalChain += length;
+			numChains++;
+		}
+		int slotBytes = 1 + sizeof(int) + h->elem_size;
+		stats->bytes_allocated = (long)h->capacity * slotBytes;
+		stats->bytes_unused = (long)(h->capacity - h->num_elems) * slotBytes;
+	} else {
+		stats->num_buckets = h->num_buckets;
+		stats->bytes_allocated = (long)h->num_buckets * sizeof(vector);
+		for (int i = 0; i < h->num_buckets; i++) {
+			const vector *v = h->buckets + i;
+			int length = VectorLength(v);
+			if (length == 0) stats->num_empty_buckets++;
+			else {
+				totalChain += length;
+				numChains++;
+			}
+			RecordChain(stats, length);
+			if (BucketAllocated(v)) {
+				if (VectorData(v) != v->storage.inline_elems)
+					stats->bytes_allocated += (long)v->alloc_len * h->slot_size;
+				stats->bytes_unused += (long)(v->alloc_len - length) * h->slot_size;
+			}
+		}
+	}
+	stats->mean_chain = numChains == 0 ? 0 : (double)totalChain / numChains;
+}
+
+void HashSetPrintStats(const hashset *h, const char *name, FILE *out)
+{
+	hashsetstats stats;
+	HashSetStats(h, &stats);
+	fprintf(out, "%s: %d elements in %d %s (%d empty, load factor %.2f), %s chains %.2f long on average, at most %d\n",
+		name, stats.num_elems, stats.num_buckets, h->ctrl != NULL ? "slots" : "buckets",
+		stats.num_empty_buckets, stats.num_buckets == 0 ? 0 : (double)stats.num_elems / stats.num_buckets,
+		h->ctrl != NULL ? "probe" : "nonempty", stats.mean_chain, stats.max_chain);
+	fprintf(out, "%s: %ld bytes allocated, %ld of them for elements not yet entered\n",
+		name, stats.bytes_allocated, stats.bytes_unused);
+
+	int widest = 0;
+	for (int i = 0; i <= kHashSetStatsMaxChain; i++) {
+		if (stats.chain_lengths[i] > widest) widest = stats.chain_lengths[i];
+	}
+	for (int i = 0; i <= kHashSetStatsMaxChain; i++) {
+		if (stats.chain_lengths[i] == 0) continue;
+		int bar = (int)((50.0 * stats.chain_lengths[i] + widest - 1) / widest);
+		fprintf(out, "%s: %2d%s %9d %.*s\n", name, i, i == kHashSetStatsMaxChain ? "+" : " ",
+			stats.chain_lengths[i], bar, "##################################################");
+	}
 }
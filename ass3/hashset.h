@@ -1,6 +1,7 @@
 #ifndef _hashset_
 #define _hashset_
 #include "vector.h"
+#include <stdio.h>
 
 /* File: hashtable.h
  * ------------------
@@ -17,6 +18,11 @@
  * in the HashSetCompareFunction sense) is hashed.  Ideally, the
  * hash routine would manage to distribute the spectrum of client elements
  * as uniformly over the [0, numBuckets) range as possible.
+ *
+ * The hashset always passes INT_MAX as numBuckets, and remembers the
+ * result alongside the element.  Which bucket an element actually lands
+ * in is derived from that full hash code, which is what allows the
+ * hashset to grow without ever hashing an element a second time.
  */
 
 typedef int (*HashSetHashFunction)(const void *elemAddr, int numBuckets);
@@ -50,6 +56,17 @@ typedef int (*HashSetCompareFunction)(const void *elemAddr1, const void *elemAdd
 
 typedef void (*HashSetMapFunction)(void *elemAddr, void *auxData);
 
+/**
+ * Types: HashSetAccumulateFunction, HashSetCombineFunction
+ * --------------------------------------------------------
+ * The two halves of a reduction run by HashSetMapReduce, with the same
+ * meanings as VectorAccumulateFunction and VectorCombineFunction have
+ * for VectorMapReduce.
+ */
+
+typedef void (*HashSetAccumulateFunction)(void *elemAddr, void *partialAddr, void *auxData);
+typedef void (*HashSetCombineFunction)(void *resultAddr, const void *partialAddr, void *auxData);
+
 /**
  * Type: HashSetFreeFunction
  * -------------------------
@@ -75,8 +92,14 @@ typedef void (*HashSetFreeFunction)(void *elemAddr);
 typedef struct {
   vector* buckets;
   int elem_size;
+  int slot_size;
   int num_buckets; 
   int num_elems;
+  double max_load_factor;
+  unsigned char *ctrl;
+  void *slots;
+  int *hashes;
+  int capacity;
 	HashSetHashFunction hashfn; 
   HashSetCompareFunction comparefn;
   HashSetFreeFunction freefn;
@@ -95,9 +118,14 @@ typedef struct {
  * raised if this size is less than or equal to 0.
  *
  * The numBuckets parameter specifies the number of buckets that the elements
- * will be partitioned into.  Once a hashset is created, this number does
- * not change.  The numBuckets parameter must be in sync with the behavior of
- * the hashfn, which must return a hash code between 0 and numBuckets - 1.   
+ * are initially partitioned into.  Whenever an insertion pushes the average
+ * number of elements per bucket (the load factor) past the maximum load
+ * factor, which is 2.0 unless changed via HashSetSetMaxLoadFactor, the
+ * number of buckets grows from n to 2n + 1 (so an odd bucket count stays
+ * odd) and every element is moved over at once.
+ * A table whose eventual size is unknown can therefore start out small.
+ * Buckets are only given storage once something is entered into them, so
+ * a generous numBuckets costs little more than the bucket array itself.
  * The hashfn parameter specifies the function that is called to retrieve the
  * hash code for a given element.  See the type declaration of HashSetHashFunction
  * above for more information.  An assert is raised if numBuckets is less than or
@@ -124,6 +152,27 @@ typedef struct {
 void HashSetNew(hashset *h, int elemSize, int numBuckets, 
 		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn);
 
+/**
+ * Function: HashSetNewOpenAddressing
+ * ----------------------------------
+ * Initializes the identified hashset exactly as HashSetNew does, except
+ * that the hashset stores its elements inline in one flat array (open
+ * addressing) rather than in a vector per bucket.  However many elements
+ * it holds, it owns just three blocks of memory, and a lookup touches a
+ * single array instead of chasing a pointer to a bucket.
+ * Every other hashset function works the same way with either kind.
+ *
+ * Here numBuckets is the number of elements the hashset should be able
+ * to hold before it first has to grow.  Open-addressing hashsets grow
+ * whenever they would otherwise be more than 7/8 full, regardless of
+ * the maximum load factor.
+ *
+ * The same asserts are raised as by HashSetNew.
+ */
+
+void HashSetNewOpenAddressing(hashset *h, int elemSize, int numBuckets,
+		HashSetHashFunction hashfn, HashSetCompareFunction comparefn, HashSetFreeFunction freefn);
+
 /**
  * Function: HashSetDispose
  * ------------------------
@@ -151,6 +200,19 @@ void HashSetDispose(hashset *h);
 
 int HashSetCount(const hashset *h);
 
+/**
+ * Function: HashSetSetMaxLoadFactor
+ * ---------------------------------
+ * Sets the load factor past which the hashset grows its bucket
+ * array.  A maximum of 0 turns growth off altogether, so that the
+ * number of buckets stays exactly as passed to HashSetNew.  It has
+ * no effect on hashsets created by HashSetNewOpenAddressing.
+ *
+ * An assert is raised if maxLoadFactor is negative.
+ */
+
+void HashSetSetMaxLoadFactor(hashset *h, double maxLoadFactor);
+
 /**
  * Function: HashSetEnter
  * ----------------------
@@ -162,11 +224,30 @@ int HashSetCount(const hashset *h);
  *
  * An assert is raised if the specified address is NULL, or
  * if the embedded hash function somehow computes a hash code
- * for the element that is out of the [0, numBuckets) range.
+ * for the element that is out of the [0, INT_MAX) range.
  */
 
 void HashSetEnter(hashset *h, const void *elemAddr);
 
+/**
+ * Function: HashSetFindOrInsert
+ * -----------------------------
+ * Looks for an element matching the one at elemAddr and, if there
+ * isn't one, enters a copy of the one at elemAddr, hashing it only
+ * once either way.  Returns the address of the element in the hashset:
+ * the match, left untouched, or else the fresh copy.  If inserted isn't
+ * NULL, *inserted is set to say which of the two it was.
+ *
+ * The client may go on to change the returned element in place (to
+ * fill in the rest of a fresh copy, say) so long as its hash code and
+ * comparisons don't change.  The address is good until the next time
+ * an element is entered into the hashset.
+ *
+ * The same asserts are raised as by HashSetEnter.
+ */
+
+void *HashSetFindOrInsert(hashset *h, const void *elemAddr, bool *inserted);
+
 /**
  * Function: HashSetLookup
  * -----------------------
@@ -180,11 +261,27 @@ void HashSetEnter(hashset *h, const void *elemAddr);
  *
  * An assert is raised if the specified address is NULL, or
  * if the embedded hash function somehow computes a hash code
- * for the element that is out of the [0, numBuckets) range.
+ * for the element that is out of the [0, INT_MAX) range.
  */
 
 void *HashSetLookup(const hashset *h, const void *elemAddr);
 
+/**
+ * Functions: HashSetEnterHashed, HashSetFindOrInsertHashed, HashSetLookupHashed
+ * -----------------------------------------------------------------------------
+ * Work exactly like HashSetEnter, HashSetFindOrInsert and HashSetLookup,
+ * except that they're handed the element's hash code instead of calling
+ * hashfn for it.  hash must be what the hashset's hashfn returns for the
+ * element when asked to spread elements over INT_MAX buckets.  They're
+ * meant for containers layered over a hashset, like the concurrenthashset,
+ * that have already hashed the element for purposes of their own.  An
+ * assert is raised if hash is out of the [0, INT_MAX) range.
+ */
+
+void HashSetEnterHashed(hashset *h, const void *elemAddr, int hash);
+void *HashSetFindOrInsertHashed(hashset *h, const void *elemAddr, int hash, bool *inserted);
+void *HashSetLookupHashed(const hashset *h, const void *elemAddr, int hash);
+
 /**
  * Function: HashSetMap
  * --------------------
@@ -201,5 +298,84 @@ void *HashSetLookup(const hashset *h, const void *elemAddr);
  */
 
 void HashSetMap(hashset *h, HashSetMapFunction mapfn, void *auxData);
+
+/**
+ * Function: HashSetMapParallel
+ * ----------------------------
+ * Applies mapfn to every element, just as HashSetMap does, except that
+ * the buckets (or, for an open-addressing hashset, the slots) are split
+ * into ranges which the threads of the pool work through at the same
+ * time.  The same contract as for VectorMapParallel applies: mapfn must
+ * be thread-safe, may change its element only in ways that leave its
+ * hash code and comparisons alone, and must not change the hashset.
+ * An assert is raised if mapfn or pool is NULL.
+ */
+
+void HashSetMapParallel(hashset *h, HashSetMapFunction mapfn, void *auxData, threadpool *pool);
+
+/**
+ * Function: HashSetMapReduce
+ * --------------------------
+ * Aggregates the elements in parallel, splitting the buckets or slots
+ * into ranges as HashSetMapParallel does, with one partial result per
+ * range.  Everything else, from what resultAddr must hold on entry to
+ * the order the partial results are combined in, is as for
+ * VectorMapReduce.
+ */
+
+void HashSetMapReduce(hashset *h, HashSetAccumulateFunction accumulatefn, HashSetCombineFunction combinefn,
+		      void *resultAddr, int resultSize, void *auxData, threadpool *pool);
+
+/**
+ * Type: hashsetstats
+ * ------------------
+ * A snapshot of how a hashset's elements are spread out, and of how much
+ * memory it's holding on to, as filled in by HashSetStats.
+ *
+ * For a chained hashset, a chain is a bucket, and its length is the number
+ * of elements in it.  For an open-addressing hashset, the buckets are the
+ * slots, and the chain length of an element is the number of groups of
+ * slots a lookup of that element has to probe.  Either way, chain_lengths[i]
+ * counts the chains of length i (with kHashSetStatsMaxChain counting every
+ * chain at least that long), and mean_chain is the mean over nonempty
+ * chains, which is what a successful lookup typically has to wade through.
+ *
+ * bytes_allocated is everything the hashset has allocated for itself, and
+ * bytes_unused is the part of that set aside for elements not entered yet:
+ * unused capacity at the ends of the bucket vectors, or empty slots.
+ */
+
+#define kHashSetStatsMaxChain 16
+
+typedef struct {
+  int num_elems;
+  int num_buckets;
+  int num_empty_buckets;
+  int max_chain;
+  double mean_chain;
+  int chain_lengths[kHashSetStatsMaxChain + 1];
+  long bytes_allocated;
+  long bytes_unused;
+} hashsetstats;
+
+/**
+ * Function: HashSetStats
+ * ----------------------
+ * Fills in the hashsetstats at the specified address for the
+ * specified hashset.  It takes time proportional to the number
+ * of buckets, so it's meant for tuning, not for the inner loop.
+ */
+
+void HashSetStats(const hashset *h, hashsetstats *stats);
+
+/**
+ * Function: HashSetPrintStats
+ * ---------------------------
+ * Prints the specified hashset's statistics in human-readable
+ * form, with a histogram of its chain lengths, to the specified
+ * FILE *, prefixed by the specified name.
+ */
+
+void HashSetPrintStats(const hashset *h, const char *name, FILE *out);
      
 #endif
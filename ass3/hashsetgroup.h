@@ -0,0 +1,57 @@
+#ifndef _hashsetgroup_
+#define _hashsetgroup_
+#include "bool.h"
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* File: hashsetgroup.h
+ * --------------------
+ * The probing primitives of the open-addressing hashset (see hashset.c
+ * for how its slots are laid out), shared with the typed hashsets of
+ * typedhashset.h so they can probe the very same tables inline.  None of
+ * this is meant for clients of the hashset.
+ */
+
+#define kHashSetGroupWidth 16
+#define kHashSetEmpty 0x80
+static const uint64_t kHashSetMixer = 0x9e3779b97f4a7c15ull;
+
+static inline unsigned char HashSetTag(int hash)
+{ return ((uint64_t)hash * kHashSetMixer) >> 57; }
+
+static inline int HashSetFirstGroup(int capacity, int hash)
+{ return (((uint64_t)hash * kHashSetMixer) >> 32) & (capacity / kHashSetGroupWidth - 1); }
+
+static inline int HashSetNextGroup(int capacity, int group, int step)
+{ return (group + step) & (capacity / kHashSetGroupWidth - 1); }
+
+/*
+ * Returns true if entering one more element would leave the table more
+ * than 7/8 full, in which case it has to double before the element goes in.
+ */
+
+static inline bool HashSetMustGrow(int numElems, int capacity)
+{ return (numElems + 1) * 8 > capacity * 7; }
+
+/*
+ * Returns a mask with bit i set if and only if the ith control byte
+ * of the group starting at ctrl is equal to the specified byte.
+ */
+
+static inline unsigned HashSetGroupMatch(const unsigned char *ctrl, unsigned char byte)
+{
+#ifdef __SSE2__
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte)));
+#else
+	unsigned mask = 0;
+	for (int i = 0; i < kHashSetGroupWidth; i++) {
+		if (ctrl[i] == byte) mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "hashset.h"
+#include "typedhashset.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -163,9 +164,338 @@ static void TestHashTable(void)
   HashSetDispose(&counts);
 }
 
+/**
+ * Function: TestOpenAddressing
+ * ----------------------------
+ * Counts the letters of this file once more, this time into an
+ * open-addressing hashset, and checks that it ends up holding exactly
+ * what the chained hashset does.  Then enters enough integers to make
+ * the open-addressing hashset grow many times over, and checks that every
+ * one of them can still be found and that nothing else can.
+ */
+
+static int HashInt(const void *elem, int numBuckets)
+{
+  return (unsigned)(*(const int *)elem * 2654435761u) % numBuckets;
+}
+
+static int CompareInt(const void *elem1, const void *elem2)
+{
+  return *(const int *)elem1 - *(const int *)elem2;
+}
+
+static void TestOpenAddressing(void)
+{
+  hashset chained, open, ints;
+  vector chainedCounts, openCounts;
+  const int kNumInts = 100000;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the open-addressing test\n");
+  HashSetNew(&chained, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  HashSetNewOpenAddressing(&open, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  BuildTableOfLetterCounts(&chained);
+  BuildTableOfLetterCounts(&open);
+
+  VectorNew(&chainedCounts, sizeof(struct frequency), NULL, 0);
+  VectorNew(&openCounts, sizeof(struct frequency), NULL, 0);
+  HashSetMap(&chained, AddFrequency, &chainedCounts);
+  HashSetMap(&open, AddFrequency, &openCounts);
+  VectorSort(&chainedCounts, CompareLetter);
+  VectorSort(&openCounts, CompareLetter);
+  assert(HashSetCount(&open) == HashSetCount(&chained));
+  for (int i = 0; i < VectorLength(&openCounts); i++)
+    assert(CompareOccurrences(VectorNth(&openCounts, i), VectorNth(&chainedCounts, i)) == 0);
+  fprintf(stdout, "Both hashsets counted the same %d letters.\n", HashSetCount(&open));
+
+  HashSetNewOpenAddressing(&ints, sizeof(int), 1, HashInt, CompareInt, NULL);
+  for (int i = 0; i < kNumInts; i++) HashSetEnter(&ints, &i);
+  for (int i = 0; i < kNumInts; i++) HashSetEnter(&ints, &i);   // entering again replaces
+  assert(HashSetCount(&ints) == kNumInts);
+  for (int i = 0; i < kNumInts; i++) assert(*(int *)HashSetLookup(&ints, &i) == i);
+  for (int i = kNumInts; i < 2 * kNumInts; i++) assert(HashSetLookup(&ints, &i) == NULL);
+  fprintf(stdout, "Entered and found %d integers.\n", HashSetCount(&ints));
+
+  VectorDispose(&chainedCounts);
+  VectorDispose(&openCounts);
+  HashSetDispose(&chained);
+  HashSetDispose(&open);
+  HashSetDispose(&ints);
+}
+
+/**
+ * Function: TestFindOrInsert
+ * --------------------------
+ * Counts the letters of this file with a single HashSetFindOrInsert per
+ * letter, into hashsets of both kinds, and checks the counts against the
+ * ones BuildTableOfLetterCounts arrives at with a lookup and an enter.
+ */
+
+static void CountLettersInPlace(hashset *counts)
+{
+  struct frequency localFreq = { 0, 0 };
+  bool inserted;
+  int ch;
+  FILE *fp = fopen("hashsettest.c", "r");
+
+  assert(fp != NULL);
+  while ((ch = getc(fp)) != EOF) {
+    if (isalpha(ch)) {
+      localFreq.ch = tolower(ch);
+      struct frequency *found = HashSetFindOrInsert(counts, &localFreq, &inserted);
+      assert(inserted == (found->occurrences == 0));
+      found->occurrences++;
+    }
+  }
+  fclose(fp);
+}
+
+static void CheckFrequency(void *elem, void *expected)
+{
+  struct frequency *found = HashSetLookup(expected, elem);
+  assert(found != NULL && found->occurrences == ((struct frequency *)elem)->occurrences);
+}
+
+static void TestFindOrInsert(void)
+{
+  hashset expected, chained, open;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the find-or-insert test\n");
+  HashSetNew(&expected, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  HashSetNew(&chained, sizeof(struct frequency), 1, HashFrequency, CompareLetter, NULL);
+  HashSetNewOpenAddressing(&open, sizeof(struct frequency), 1, HashFrequency, CompareLetter, NULL);
+  BuildTableOfLetterCounts(&expected);
+  CountLettersInPlace(&chained);
+  CountLettersInPlace(&open);
+
+  assert(HashSetCount(&chained) == HashSetCount(&expected));
+  assert(HashSetCount(&open) == HashSetCount(&expected));
+  HashSetMap(&chained, CheckFrequency, &expected);
+  HashSetMap(&open, CheckFrequency, &expected);
+  fprintf(stdout, "Counting in place agrees with lookup and enter for all %d letters.\n", HashSetCount(&expected));
+
+  HashSetDispose(&expected);
+  HashSetDispose(&chained);
+  HashSetDispose(&open);
+}
+
+/**
+ * Function: TestTyped
+ * -------------------
+ * Counts the letters of this file into a typed hashset, one
+ * NameFindOrInsert per letter, and checks the counts against the ones
+ * the generic hashset arrives at.  Then enters enough integers into a
+ * typed hashset, starting from a single bucket, to make it grow many
+ * times over, mixing NameEnter and NameFindOrInsert, and checks that it
+ * holds exactly what a generic hashset fed the same integers does.
+ */
+
+static inline unsigned LetterHash(const struct frequency *freq)
+{
+  return freq->ch;
+}
+
+static inline bool LetterEqual(const struct frequency *freq1, const struct frequency *freq2)
+{
+  return freq1->ch == freq2->ch;
+}
+
+static inline unsigned IntHash(const int *elem)
+{
+  return *elem * 2654435761u;
+}
+
+static inline bool IntEqual(const int *elem1, const int *elem2)
+{
+  return *elem1 == *elem2;
+}
+
+DEFINE_TYPED_HASHSET(letterset, struct frequency, LetterHash, LetterEqual)
+DEFINE_TYPED_HASHSET(intset, int, IntHash, IntEqual)
+
+static void CheckInt(void *elem, void *expected)
+{
+  int *found = HashSetLookup(expected, elem);
+  assert(found != NULL && *found == *(int *)elem);
+}
+
+static void TestTyped(void)
+{
+  hashset expected, ints;
+  letterset letters;
+  intset typedInts;
+  struct frequency localFreq = { 0, 0 };
+  bool inserted;
+  int ch;
+  const int kNumInts = 100000;
+  FILE *fp = fopen("hashsettest.c", "r");
+
+  fprintf(stdout, "\n\n ------------------------- Starting the typed hashset test\n");
+  HashSetNew(&expected, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  BuildTableOfLetterCounts(&expected);
+  lettersetNew(&letters, 1, NULL);
+  assert(fp != NULL);
+  while ((ch = getc(fp)) != EOF) {
+    if (isalpha(ch)) {
+      localFreq.ch = tolower(ch);
+      struct frequency *found = lettersetFindOrInsert(&letters, &localFreq, &inserted);
+      assert(inserted == (found->occurrences == 0));
+      assert(lettersetLookup(&letters, &localFreq) == found);
+      found->occurrences++;
+    }
+  }
+  fclose(fp);
+  assert(lettersetCount(&letters) == HashSetCount(&expected));
+  lettersetMap(&letters, CheckFrequency, &expected);
+  fprintf(stdout, "The typed hashset counted the same %d letters.\n", lettersetCount(&letters));
+
+  HashSetNewOpenAddressing(&ints, sizeof(int), 1, HashInt, CompareInt, NULL);
+  intsetNew(&typedInts, 1, NULL);
+  for (int i = 0; i < kNumInts; i++) {
+    int number = (i * 7919) % (kNumInts / 2);      // every number turns up twice
+    HashSetEnter(&ints, &number);
+    if (i % 2 == 0) intsetEnter(&typedInts, &number);
+    else intsetFindOrInsert(&typedInts, &number, NULL);
+  }
+  assert(intsetCount(&typedInts) == HashSetCount(&ints));
+  intsetMap(&typedInts, CheckInt, &ints);
+  for (int i = 0; i < kNumInts; i++) assert((intsetLookup(&typedInts, &i) == NULL) == (HashSetLookup(&ints, &i) == NULL));
+  fprintf(stdout, "The typed and generic hashsets both hold the same %d integers.\n", intsetCount(&typedInts));
+
+  HashSetDispose(&expected);
+  HashSetDispose(&ints);
+  lettersetDispose(&letters);
+  intsetDispose(&typedInts);
+}
+
+/**
+ * Function: TestStats
+ * -------------------
+ * Checks that the statistics of a chained and an open-addressing letter
+ * count table add up (every bucket or element lands in the histogram
+ * exactly once, and nothing unused outweighs what's allocated), then
+ * prints those of the chained one.
+ */
+
+static void CheckStats(const hashset *h, bool chained)
+{
+  hashsetstats stats;
+  int numChains = 0, numElems = 0;
+
+  HashSetStats(h, &stats);
+  for (int i = 0; i <= kHashSetStatsMaxChain; i++) {
+    numChains += stats.chain_lengths[i];
+    numElems += i * stats.chain_lengths[i];
+  }
+  assert(stats.num_elems == HashSetCount(h));
+  assert(numChains == (chained ? stats.num_buckets : stats.num_elems));
+  if (chained) assert(numElems == stats.num_elems);
+  assert(stats.num_empty_buckets <= stats.num_buckets);
+  assert(stats.max_chain >= stats.mean_chain);
+  assert(stats.bytes_unused >= 0 && stats.bytes_unused < stats.bytes_allocated);
+}
+
+static void TestStats(void)
+{
+  hashset chained, open;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the statistics test\n");
+  HashSetNew(&chained, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  HashSetNewOpenAddressing(&open, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  BuildTableOfLetterCounts(&chained);
+  BuildTableOfLetterCounts(&open);
+  CheckStats(&chained, true);
+  CheckStats(&open, false);
+  HashSetPrintStats(&chained, "letters", stdout);
+
+  HashSetDispose(&chained);
+  HashSetDispose(&open);
+}
+
+/**
+ * Functions: AddOccurrences, AddTotals, DoubleOccurrences
+ * -------------------------------------------------------
+ * Helpers for TestParallelMap.  The first two total up the occurrences
+ * of every letter with HashSetMapReduce: the first adds a frequency
+ * to a partial total, and the second adds one total to another.  The
+ * third doubles a frequency in place, which is safe to do from several
+ * threads at once because each call changes only its own element.
+ */
+
+static void AddOccurrences(void *elem, void *partial, void *unused)
+{
+  *(long *)partial += ((struct frequency *)elem)->occurrences;
+}
+
+static void AddTotals(void *result, const void *partial, void *unused)
+{
+  *(long *)result += *(const long *)partial;
+}
+
+static void DoubleOccurrences(void *elem, void *unused)
+{
+  ((struct frequency *)elem)->occurrences *= 2;
+}
+
+static void AddOccurrencesSerially(void *elem, void *total)
+{
+  AddOccurrences(elem, total, NULL);
+}
+
+static const int kNumThreads = 4;
+
+static void CheckParallelMap(hashset *counts, threadpool *pool, long *total)
+{
+  long expected = 0;
+  HashSetMap(counts, AddOccurrencesSerially, &expected);
+  *total = 0;
+  HashSetMapReduce(counts, AddOccurrences, AddTotals, total, sizeof(long), NULL, pool);
+  assert(*total == expected);
+
+  HashSetMapParallel(counts, DoubleOccurrences, NULL, pool);
+  long doubled = 0;
+  HashSetMapReduce(counts, AddOccurrences, AddTotals, &doubled, sizeof(long), NULL, pool);
+  assert(doubled == 2 * expected);
+}
+
+/**
+ * Function: TestParallelMap
+ * -------------------------
+ * Counts the letters of this file into both kinds of hashset, then has
+ * a pool of threads total the counts with HashSetMapReduce and double
+ * them in place with HashSetMapParallel, checking each step against
+ * the plain sequential HashSetMap.
+ */
+
+static void TestParallelMap(void)
+{
+  hashset chained, open;
+  threadpool pool;
+  long chainedTotal, openTotal;
+
+  fprintf(stdout, "\n\n ------------------------- Starting the parallel map test\n");
+  ThreadPoolNew(&pool, kNumThreads);
+  HashSetNew(&chained, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  HashSetNewOpenAddressing(&open, sizeof(struct frequency), kNumBuckets, HashFrequency, CompareLetter, NULL);
+  BuildTableOfLetterCounts(&chained);
+  BuildTableOfLetterCounts(&open);
+  CheckParallelMap(&chained, &pool, &chainedTotal);
+  CheckParallelMap(&open, &pool, &openTotal);
+  assert(chainedTotal == openTotal);
+  fprintf(stdout, "%d threads totalled %ld letters in both hashsets, and doubled every count in place.\n",
+          ThreadPoolSize(&pool), chainedTotal);
+  HashSetDispose(&chained);
+  HashSetDispose(&open);
+  ThreadPoolDispose(&pool);
+}
+
 int main(int ununsed, char **alsoUnused) 
 {
   TestHashTable();	
+  TestOpenAddressing();
+  TestFindOrInsert();
+  TestTyped();
+  TestStats();
+  TestParallelMap();
   return 0;
 }
 
@@ -0,0 +1,108 @@
+/**
+ * File: sort-bench.c
+ * ------------------
+ * Micro-benchmark comparing the ways of sorting a vector: qsort (what
+ * VectorSort used to be), VectorSort, the typed sort generated by
+ * DEFINE_TYPED_VECTOR_SORT, VectorSortStable, VectorSortParallel and
+ * VectorRadixSort.  Every one of them sorts the same random ints, with
+ * plenty of duplicates, and then the same ints already in order.
+ *
+ *     ./sort-bench [number of elements] [number of threads]
+ */
+
+#include "vector.h"
+#include "typedvector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const int kDefaultNumElems = 2000000;
+static const int kDefaultNumThreads = 4;
+
+static double Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int CompareInt(const void *elem1, const void *elem2)
+{
+  int a = *(const int *)elem1, b = *(const int *)elem2;
+  return (a > b) - (a < b);
+}
+
+static unsigned int IntKey(const void *elem)
+{ return (unsigned int)*(const int *)elem ^ 0x80000000; }
+
+static inline bool IntLess(const int *a, const int *b)
+{ return *a < *b; }
+
+DEFINE_TYPED_VECTOR(intvector, int)
+DEFINE_TYPED_VECTOR_SORT(intvector, IntLess)
+
+static int numThreads;
+
+static void QSort(vector *v) { qsort(VectorData(v), VectorLength(v), sizeof(int), CompareInt); }
+static void IntroSort(vector *v) { VectorSort(v, CompareInt); }
+static void TypedSort(vector *v) { intvectorSort((intvector *)v); }
+static void StableSort(vector *v) { VectorSortStable(v, CompareInt); }
+static void ParallelSort(vector *v) { VectorSortParallel(v, CompareInt, numThreads); }
+static void RadixSort(vector *v) { VectorRadixSort(v, IntKey); }
+
+/**
+ * Function: Benchmark
+ * -------------------
+ * Copies the ints into a fresh vector, sorts them with sortfn, checks
+ * the result, and reports how long the sort alone took.
+ */
+
+static void Benchmark(const char *name, void (*sortfn)(vector *), const int *ints, int numElems)
+{
+  vector v;
+  VectorNew(&v, sizeof(int), NULL, numElems);
+  VectorAppendN(&v, ints, numElems);
+  double start = Now();
+  sortfn(&v);
+  double seconds = Now() - start;
+  for (int i = 1; i < numElems; i++) {
+    if (*(int *)VectorNth(&v, i - 1) > *(int *)VectorNth(&v, i)) {
+      fprintf(stderr, "%s didn't sort!\n", name);
+      exit(1);
+    }
+  }
+  printf("%-34s %8.2f ms %8.2f ns/elem\n", name, seconds * 1e3, seconds * 1e9 / numElems);
+  VectorDispose(&v);
+}
+
+static void BenchmarkAll(const char *shape, const int *ints, int numElems)
+{
+  char name[64];
+  const char *kNames[] = {"qsort", "VectorSort", "typed sort", "VectorSortStable", "VectorSortParallel", "VectorRadixSort"};
+  void (*kSorts[])(vector *) = {QSort, IntroSort, TypedSort, StableSort, ParallelSort, RadixSort};
+  for (int i = 0; i < sizeof(kSorts) / sizeof(kSorts[0]); i++) {
+    sprintf(name, "%s, %s", kNames[i], shape);
+    Benchmark(name, kSorts[i], ints, numElems);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int numElems = (argc > 1) ? atoi(argv[1]) : kDefaultNumElems;
+  numThreads = (argc > 2) ? atoi(argv[2]) : kDefaultNumThreads;
+  if (numElems <= 0 || numThreads <= 0) {
+    fprintf(stderr, "Usage: sort-bench [number of elements] [number of threads]\n");
+    return 1;
+  }
+
+  int *ints = malloc(numElems * sizeof(int));
+  srand(107);
+  for (int i = 0; i < numElems; i++) ints[i] = rand() % (numElems / 4 + 1);
+  printf("Sorting %d ints (with %d threads for VectorSortParallel).\n", numElems, numThreads);
+  BenchmarkAll("random", ints, numElems);
+  for (int i = 0; i < numElems; i++) ints[i] = i;
+  BenchmarkAll("sorted", ints, numElems);
+  free(ints);
+  return 0;
+}
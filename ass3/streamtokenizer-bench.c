@@ -0,0 +1,149 @@
+/**
+ * File: streamtokenizer-bench.c
+ * -----------------------------
+ * Micro-benchmark for the streamtokenizer.  Writes a temporary file of
+ * random words separated by the same punctuation-heavy delimiters the
+ * RSS news search uses, and then tokenizes it with getc and strchr (what
+ * the streamtokenizer used to do), STNextToken, STNextTokenSpan, and
+ * STNextTokenUsingDifferentDelimiters switching between two delimiter
+ * strings, both as a mapped file and through a pipe.
+ *
+ *     ./streamtokenizer-bench [megabytes of text]
+ */
+
+#include "streamtokenizer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const int kDefaultMegabytes = 32;
+static const char *const kTextDelimiters = " \t\n\r\b!@$%^*()_+={[}]|\\'\":;/?.>,<~`";
+static const char *const kWhiteSpace = " \t\n\r";
+
+static double Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void WriteText(FILE *outfile, long numBytes)
+{
+  const char *kSeparators[] = {" ", " ", " ", " ", ", ", ". ", "\n", "\"", "'s ", " (", ") ", "; "};
+  long written = 0;
+  srand(107);
+  while (written < numBytes) {
+    int length = 1 + rand() % 12;
+    for (int i = 0; i < length; i++) putc('a' + rand() % 26, outfile);
+    const char *separator = kSeparators[rand() % (sizeof(kSeparators) / sizeof(kSeparators[0]))];
+    fputs(separator, outfile);
+    written += length + strlen(separator);
+  }
+}
+
+static long GetcStrchr(FILE *infile)
+{
+  long numTokens = 0;
+  int ch, inToken = 0;
+  while ((ch = getc(infile)) != EOF) {
+    int isDelimiter = strchr(kTextDelimiters, ch) != NULL;
+    if (!isDelimiter && !inToken) numTokens++;
+    inToken = !isDelimiter;
+  }
+  return numTokens;
+}
+
+static long NextToken(FILE *infile)
+{
+  streamtokenizer st;
+  char word[1024];
+  long numTokens = 0;
+  STNew(&st, infile, kTextDelimiters, true);
+  while (STNextToken(&st, word, sizeof(word))) numTokens++;
+  STDispose(&st);
+  return numTokens;
+}
+
+static long NextTokenSpan(FILE *infile)
+{
+  streamtokenizer st;
+  const char *token;
+  int length;
+  long numTokens = 0;
+  STNew(&st, infile, kTextDelimiters, true);
+  while (STNextTokenSpan(&st, &token, &length)) numTokens++;
+  STDispose(&st);
+  return numTokens;
+}
+
+static long DifferentDelimiters(FILE *infile)
+{
+  streamtokenizer st;
+  char word[1024];
+  long numTokens = 0;
+  STNew(&st, infile, kTextDelimiters, true);
+  while (STNextTokenUsingDifferentDelimiters(&st, word, sizeof(word),
+                                             numTokens % 2 == 0 ? kTextDelimiters : kWhiteSpace))
+    numTokens++;
+  STDispose(&st);
+  return numTokens;
+}
+
+/**
+ * Function: Benchmark
+ * -------------------
+ * Opens the text, either directly or through cat, tokenizes all of it
+ * with tokenize, and reports how long that took.
+ */
+
+static void Benchmark(const char *name, long (*tokenize)(FILE *), const char *filename, bool piped, long numBytes)
+{
+  char command[1024];
+  snprintf(command, sizeof(command), "cat %s", filename);
+  FILE *infile = piped ? popen(command, "r") : fopen(filename, "r");
+  if (infile == NULL) {
+    perror(filename);
+    exit(1);
+  }
+  double start = Now();
+  long numTokens = tokenize(infile);
+  double seconds = Now() - start;
+  if (piped) pclose(infile);
+  else fclose(infile);
+  printf("%-38s %8.2f ms %8.1f MB/s %10ld tokens\n", name, seconds * 1e3,
+         numBytes / seconds / (1 << 20), numTokens);
+}
+
+int main(int argc, char *argv[])
+{
+  int megabytes = (argc > 1) ? atoi(argv[1]) : kDefaultMegabytes;
+  if (megabytes <= 0) {
+    fprintf(stderr, "Usage: streamtokenizer-bench [megabytes of text]\n");
+    return 1;
+  }
+
+  char filename[] = "/tmp/streamtokenizer-bench-XXXXXX";
+  int fd = mkstemp(filename);
+  FILE *outfile = fd < 0 ? NULL : fdopen(fd, "w");
+  if (outfile == NULL) {
+    perror(filename);
+    return 1;
+  }
+  long numBytes = (long)megabytes << 20;
+  WriteText(outfile, numBytes);
+  fclose(outfile);
+
+  printf("Tokenizing %d MB of text.\n", megabytes);
+  for (int piped = 0; piped <= 1; piped++) {
+    char name[64];
+    const char *kNames[] = {"getc and strchr", "STNextToken", "STNextTokenSpan", "different delimiters"};
+    long (*kTokenizers[])(FILE *) = {GetcStrchr, NextToken, NextTokenSpan, DifferentDelimiters};
+    for (int i = 0; i < sizeof(kTokenizers) / sizeof(kTokenizers[0]); i++) {
+      sprintf(name, "%s, %s", kNames[i], piped ? "piped" : "mapped");
+      Benchmark(name, kTokenizers[i], filename, piped, numBytes);
+    }
+  }
+  remove(filename);
+  return 0;
+}
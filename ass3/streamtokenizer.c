@@ -4,88 +4,361 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <assert.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ST_SIMD_SCAN
+#endif
+
+/*
+ * Every character between cursor and end has been read ahead but not
+ * yet handed out.  A mapped file is read ahead all at once, so it never
+ * needs refilling.  Otherwise, a refill slides the characters from
+ * cursor onward down to the front of the buffer (doubling it if they
+ * fill it, as happens with tokens longer than it is) and reads more in
+ * behind them, so a token being formed always sits in one piece.
+ *
+ * Sets of delimiters are compiled into delimitersets (see
+ * streamtokenizer.h) rather than searched with strchr.  strchr finds the
+ * '\0' at the end of any string, so '\0' has always been a member of
+ * every set, and it still is.  Runs of delimiters or non-delimiters are
+ * crossed by the streamtokenizer's span function, which on x86 tests 32
+ * characters at a time with AVX2, or 16 with SSSE3, whichever the
+ * processor running the program has.
+ */
+
+static const size_t kBufferSize = 1 << 16;
+
+static void CompileDelimiters(delimiterset *set, const char *chars)
+{
+  memset(set->bits, 0, sizeof(set->bits));
+  do {
+    unsigned char ch = *chars;
+    set->bits[((ch >> 7) << 4) | (ch & 0x0f)] |= 1 << ((ch >> 4) & 7);
+  } while (*chars++ != '\0');
+}
+
+static inline bool IsDelimiter(const delimiterset *set, unsigned char ch)
+{ return (set->bits[((ch >> 7) << 4) | (ch & 0x0f)] >> ((ch >> 4) & 7)) & 1; }
+
+/*
+ * Returns the address of the first character in [start, end) whose
+ * membership in set differs from delimiters, or end if there isn't one.
+ * That's the end of a run of delimiters if delimiters is true, and the
+ * end of a run of non-delimiters if it's false.
+ */
+
+static const char *SpanScalar(const delimiterset *set, const char *start, const char *end, bool delimiters)
+{
+  while (start < end && IsDelimiter(set, *start) == delimiters) start++;
+  return start;
+}
+
+#ifdef ST_SIMD_SCAN
+
+/*
+ * The vectorized Spans look up 16 characters (one 128-bit lane) at a
+ * time.  The low nibble of each character indexes the first 16 bytes of
+ * the bitmap for characters below 0x80 and the second 16 for the rest:
+ * pshufb zeroes any lane whose index has its top bit set, so indexing
+ * both halves with ch & 0x8f, and the second with its top bit flipped,
+ * leaves just the right half's byte standing.
+ * The high nibble then picks the bit out of the byte looked up.  The
+ * tail of fewer than a full vector is left to SpanScalar, so nothing
+ * past end is ever read.
+ */
+
+/*
+ * Returns a mask with bit i set if and only if start[i] is where a span
+ * over the 16 characters at start would stop.  It's always inlined, so
+ * that SpanAVX2's copy is VEX-encoded like the rest of it: falling back
+ * into SpanSSSE3's legacy SSE encoding with the upper halves of the
+ * ymm registers dirty would stall every call.
+ */
+
+__attribute__((target("ssse3"), always_inline))
+static inline unsigned Stops16(const delimiterset *set, const char *start, bool delimiters)
+{
+  const __m128i lowTable = _mm_loadu_si128((const __m128i *)set->bits);
+  const __m128i highTable = _mm_loadu_si128((const __m128i *)(set->bits + 16));
+  const __m128i bitTable = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  __m128i chunk = _mm_loadu_si128((const __m128i *)start);
+  __m128i lowIndex = _mm_and_si128(chunk, _mm_set1_epi8(0x8f));
+  __m128i row = _mm_or_si128(_mm_shuffle_epi8(lowTable, lowIndex),
+                             _mm_shuffle_epi8(highTable, _mm_xor_si128(lowIndex, _mm_set1_epi8(0x80))));
+  __m128i bit = _mm_shuffle_epi8(bitTable, _mm_and_si128(_mm_srli_epi16(chunk, 4), _mm_set1_epi8(0x0f)));
+  __m128i outside = _mm_cmpeq_epi8(_mm_and_si128(row, bit), _mm_setzero_si128());
+  return _mm_movemask_epi8(outside) ^ (delimiters ? 0 : 0xffff);
+}
+
+__attribute__((target("ssse3")))
+static const char *SpanSSSE3(const delimiterset *set, const char *start, const char *end, bool delimiters)
+{
+  for (; end - start >= 16; start += 16) {
+    unsigned stops = Stops16(set, start, delimiters);
+    if (stops != 0) return start + __builtin_ctz(stops);
+  }
+  return SpanScalar(set, start, end, delimiters);
+}
+
+__attribute__((target("avx2")))
+static const char *SpanAVX2(const delimiterset *set, const char *start, const char *end, bool delimiters)
+{
+  const __m256i lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->bits));
+  const __m256i highTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(set->bits + 16)));
+  const __m256i bitTable = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  const __m256i lowIndexMask = _mm256_set1_epi8(0x8f), topBit = _mm256_set1_epi8(0x80);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const unsigned flip = delimiters ? 0 : 0xffffffffu;
+  for (; end - start >= 32; start += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)start);
+    __m256i lowIndex = _mm256_and_si256(chunk, lowIndexMask);
+    __m256i row = _mm256_or_si256(_mm256_shuffle_epi8(lowTable, lowIndex),
+                                  _mm256_shuffle_epi8(highTable, _mm256_xor_si256(lowIndex, topBit)));
+    __m256i bit = _mm256_shuffle_epi8(bitTable, _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble));
+    __m256i outside = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), _mm256_setzero_si256());
+    unsigned stops = (unsigned)_mm256_movemask_epi8(outside) ^ flip;
+    if (stops != 0) return start + __builtin_ctz(stops);
+  }
+  if (end - start >= 16) {
+    unsigned stops = Stops16(set, start, delimiters);
+    if (stops != 0) return start + __builtin_ctz(stops);
+    start += 16;
+  }
+  return SpanScalar(set, start, end, delimiters);
+}
+
+#endif
+
+/*
+ * Returns the fastest span function the processor running the program supports.
+ * STNew asks once and keeps the answer, so the check isn't repeated for
+ * every run of characters crossed.
+ */
+
+static STSpanFunction ChooseSpan(void)
+{
+#ifdef ST_SIMD_SCAN
+  if (__builtin_cpu_supports("avx2")) return SpanAVX2;
+  if (__builtin_cpu_supports("ssse3")) return SpanSSSE3;
+#endif
+  return SpanScalar;
+}
+
+/*
+ * Maps the rest of a regular file into memory, returning false if
+ * infile isn't a regular file, has nothing left in it, or can't be
+ * mapped.
+ */
+
+static bool MapFile(streamtokenizer *st, long offset)
+{
+  struct stat info;
+  int fd = fileno(st->infile);
+  if (offset < 0 || fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) return false;
+  if (info.st_size <= offset) return false;
+
+  long pageSize = sysconf(_SC_PAGESIZE);
+  long mapOffset = offset - offset % pageSize;
+  size_t mappedLength = info.st_size - mapOffset;
+  void *mapping = mmap(NULL, mappedLength, PROT_READ, MAP_PRIVATE, fd, mapOffset);
+  if (mapping == MAP_FAILED) return false;
+  madvise(mapping, mappedLength, MADV_SEQUENTIAL);
+
+  st->buffer = mapping;
+  st->mappedLength = mappedLength;
+  st->bufferOffset = mapOffset;
+  st->cursor = st->buffer + (offset - mapOffset);
+  st->end = st->buffer + mappedLength;
+  return true;
+}
+
+static bool IsInteractive(FILE *infile)
+{
+  struct stat info;
+  int fd = fileno(infile);
+  return fd >= 0 && fstat(fd, &info) == 0 && !S_ISREG(info.st_mode);
+}
+
+/*
+ * Reads more characters in behind the ones not yet handed out, and
+ * returns false if there were no more to read.
+ */
+
+static bool Refill(streamtokenizer *st)
+{
+  if (st->mappedLength != 0) return false;
+  size_t kept = st->end - st->cursor, discarded = st->cursor - st->buffer;
+  memmove(st->buffer, st->cursor, kept);
+  if (st->bufferOffset >= 0) st->bufferOffset += discarded;
+  if (kept == st->capacity) {
+    st->capacity *= 2;
+    st->buffer = realloc(st->buffer, st->capacity);
+    assert(st->buffer != NULL);
+  }
+
+  size_t numRead;
+  if (st->readLines) {
+    int next = EOF;
+    flockfile(st->infile);
+    for (numRead = 0; kept + numRead < st->capacity && next != '\n'; numRead++) {
+      next = getc_unlocked(st->infile);
+      if (next == EOF) break;
+      st->buffer[kept + numRead] = next;
+    }
+    funlockfile(st->infile);
+  } else {
+    numRead = fread(st->buffer + kept, 1, st->capacity - kept, st->infile);
+  }
+  st->cursor = st->buffer;
+  st->end = st->buffer + kept + numRead;
+  return numRead > 0;
+}
 
 void STNew(streamtokenizer *st, FILE *infile, const char *delimiters, bool discardDelimiters)
 {
   assert(infile != NULL);
   assert(delimiters != NULL);
   assert(strlen(delimiters) > 0);
-  
+
   st->infile = infile;
   st->discardDelimiters = discardDelimiters;
   st->delimiters = strdup(delimiters);
+  CompileDelimiters(&st->delimiterSet, delimiters);
+  st->span = ChooseSpan();
+  for (int i = 0; i < kSTCachedDelimiterSets; i++) st->cachedDelimiters[i] = NULL;
+  st->nextCachedSet = 0;
+
+  st->mappedLength = 0;
+  st->readLines = false;
+  if (!MapFile(st, ftell(infile))) {
+    st->bufferOffset = ftell(infile);
+    st->readLines = IsInteractive(infile);
+    st->capacity = kBufferSize;
+    st->buffer = malloc(st->capacity);
+    assert(st->buffer != NULL);
+    st->cursor = st->end = st->buffer;
+  }
 }
 
 void STDispose(streamtokenizer *st)
 {
   free((void *) st->delimiters);  // donates the memory allocated by strdup back to the heap
+  for (int i = 0; i < kSTCachedDelimiterSets; i++) free(st->cachedDelimiters[i]);
+  if (st->bufferOffset >= 0) fseek(st->infile, st->bufferOffset + (st->cursor - st->buffer), SEEK_SET);
+  if (st->mappedLength != 0) munmap(st->buffer, st->mappedLength);
+  else free(st->buffer);
 }
 
-bool STNextToken(streamtokenizer *st, char buffer[], int bufferLength)
+/*
+ * Skips characters for as long as their membership in set is the
+ * same as skipping, and returns the first one that's different
+ * (leaving it to be read next), or EOF if there isn't one.
+ */
+
+static int Skip(streamtokenizer *st, const delimiterset *set, bool skipping)
 {
-	return STNextTokenUsingDifferentDelimiters(st, buffer, bufferLength, st->delimiters);
+  while (true) {
+    st->cursor = st->span(set, st->cursor, st->end, skipping);
+    if (st->cursor < st->end) return (unsigned char)*st->cursor;
+    if (!Refill(st)) return EOF;
+  }
 }
 
-bool STNextTokenUsingDifferentDelimiters(streamtokenizer *st, char buffer[], int bufferLength, const char *delimiters)
+/*
+ * The heart of every STNextToken variant: forms the next token of at
+ * most maxLength characters, leaves it in place, and reports where it
+ * is and how long it is.
+ */
+
+static bool NextToken(streamtokenizer *st, const delimiterset *delimiterSet, size_t maxLength,
+                      const char **token, size_t *length)
 {
-  int i;
-  int next;
-  
-  assert(buffer != NULL);
-  assert(bufferLength >= 2);
-  
-  if (st->discardDelimiters) STSkipOver(st, delimiters);
-  next = getc(st->infile);
-  if (next == EOF) return false;
-  buffer[0] = next;
-  if (strchr(delimiters, next) != NULL) {
-    buffer[1] = '\0';
-    return true;
-  }
-  
-  // pull characters until hit stop character, or until buffer is full
-  for (i = 1; i < bufferLength - 1; i++) { // leave room for '\0'
-    next = fgetc(st->infile);
-    if (next == EOF) break;
-    if (strchr(delimiters, next) != NULL) {
-      ungetc(next, st->infile);
-      break;
+  if (st->discardDelimiters) Skip(st, delimiterSet, true);
+  if (st->cursor == st->end && !Refill(st)) return false;
+
+  size_t n = 1;
+  if (!IsDelimiter(delimiterSet, *st->cursor)) {
+    // pull characters until hit stop character, or until there are maxLength of them
+    while (true) {
+      const char *start = st->cursor;
+      const char *limit = (size_t)(st->end - start) > maxLength ? start + maxLength : st->end;
+      n = st->span(delimiterSet, start + n, limit, false) - start;
+      if (n == maxLength || start + n < st->end || !Refill(st)) break;
     }
-    
-    buffer[i] = next; 
   }
-  
-  // i indexes place where null-term should be placed...
-  buffer[i] = '\0';
+  *token = st->cursor;
+  *length = n;
+  st->cursor += n;
   return true;
 }
 
-static bool HaveReasonToStop(const char *charSet, int next, bool skipping)
+bool STNextToken(streamtokenizer *st, char buffer[], int bufferLength)
 {
-  bool inSet = (strchr(charSet, next) != NULL);
-  return ((inSet && !skipping) || (!inSet && skipping));
+	return STNextTokenUsingDifferentDelimiters(st, buffer, bufferLength, st->delimiters);
 }
 
-static int STSkipHelper(streamtokenizer *st, const char *charSet, bool skipping)
+/*
+ * Returns the compiled form of delimiters, compiling it into the cache
+ * (in place of the entry used longest ago) if it isn't there already.
+ */
+
+static const delimiterset *LookupDelimiters(streamtokenizer *st, const char *delimiters)
 {
-  int next;
-  
-  while (true) {
-    next = getc(st->infile);
-    if (next == EOF) return EOF;
-    if (HaveReasonToStop(charSet, next, skipping)) break;
+  if (delimiters == st->delimiters || strcmp(delimiters, st->delimiters) == 0) return &st->delimiterSet;
+  for (int i = 0; i < kSTCachedDelimiterSets; i++) {
+    if (st->cachedDelimiters[i] != NULL && strcmp(delimiters, st->cachedDelimiters[i]) == 0)
+      return &st->cachedSets[i];
   }
-  
-  ungetc(next, st->infile); 
-  return next;
+
+  int entry = st->nextCachedSet;
+  st->nextCachedSet = (entry + 1) % kSTCachedDelimiterSets;
+  free(st->cachedDelimiters[entry]);
+  st->cachedDelimiters[entry] = strdup(delimiters);
+  CompileDelimiters(&st->cachedSets[entry], delimiters);
+  return &st->cachedSets[entry];
+}
+
+bool STNextTokenUsingDifferentDelimiters(streamtokenizer *st, char buffer[], int bufferLength, const char *delimiters)
+{
+  const char *token;
+  size_t length;
+
+  assert(buffer != NULL);
+  assert(bufferLength >= 2);
+
+  if (!NextToken(st, LookupDelimiters(st, delimiters), bufferLength - 1, &token, &length))
+    return false; // leave room for '\0'
+  memcpy(buffer, token, length);
+  buffer[length] = '\0';
+  return true;
+}
+
+bool STNextTokenSpan(streamtokenizer *st, const char **token, int *length)
+{
+  size_t tokenLength;
+
+  assert(token != NULL);
+  assert(length != NULL);
+
+  if (!NextToken(st, &st->delimiterSet, (size_t)-1, token, &tokenLength)) return false;
+  *length = tokenLength;
+  return true;
 }
 
 int STSkipUntil(streamtokenizer *st, const char *skipUntilSet)
 {
-  return STSkipHelper(st, skipUntilSet, false);
+  delimiterset set;
+  CompileDelimiters(&set, skipUntilSet);
+  return Skip(st, &set, false);
 }
 
 int STSkipOver(streamtokenizer *st, const char *skipSet)
 {
-  return STSkipHelper(st, skipSet, true);
+  delimiterset set;
+  CompileDelimiters(&set, skipSet);
+  return Skip(st, &set, true);
 }
@@ -2,6 +2,7 @@
 #define _streamtokenizer_
 
 #include "bool.h"
+#include <stddef.h>
 #include <stdio.h>
 
 /**
@@ -30,17 +31,78 @@
  * It could do anything at all with the token that populates the client-supplied
  * character buffer called word.
  *
- * Note that the client should not at all access the three fields of
+ * Note that the client should not at all access the fields of
  * streamtokenizer directly.  The only reason you see them here is because
  * there's no easy way to hide them in C.  You should pretend that they've
  * been marked as private.  Let the implementations of all the streamtokenizer
  * functions manage the fields for you.
+ *
+ * The streamtokenizer doesn't read the file a character at a time.  A
+ * regular file is mapped into memory with mmap, from the stream's current
+ * position to the end, and scanned in place.  Anything else (a pipe, a
+ * terminal, or a file that can't be mapped) is read into a large buffer,
+ * a line at a time for pipes and terminals so that interactive input
+ * isn't held up.  Either way, the tokenizer reads ahead of the tokens it
+ * has handed out, so the client must not read from the FILE * itself until
+ * STDispose has been called, which puts the stream back at the first
+ * character the tokenizer hasn't handed out (for streams that can seek).
+ */
+
+/**
+ * Type: delimiterset
+ * ------------------
+ * A set of delimiters compiled into a 256-bit bitmap, one bit per
+ * character, so that a character's membership is a single lookup rather
+ * than a scan of the delimiter string.  The bits are laid out so that the
+ * same bitmap doubles as the pair of 16-entry shuffle tables that a SIMD
+ * scan needs to test 16 or 32 characters at once: byte
+ * ((ch >> 7) << 4) | (ch & 0x0f) holds the bit for ch at position
+ * (ch >> 4) & 7.
+ */
+
+typedef struct {
+  unsigned char bits[32];
+} delimiterset;
+
+/**
+ * Constant: kSTCachedDelimiterSets
+ * --------------------------------
+ * The number of delimiter strings, besides the one passed to STNew, whose
+ * compiled delimitersets a streamtokenizer remembers, so that calls to
+ * STNextTokenUsingDifferentDelimiters that keep passing the same few
+ * strings don't compile them over and over again.
+ */
+
+#define kSTCachedDelimiterSets 4
+
+/**
+ * Type: STSpanFunction
+ * --------------------
+ * A function that returns the address of the first character in
+ * [start, end) whose membership in set differs from delimiters, or end
+ * if there isn't one.  There's one per instruction set the scan can use,
+ * and STNew picks the best one the processor supports.
  */
 
+typedef const char *(*STSpanFunction)(const delimiterset *set, const char *start, const char *end,
+                                      bool delimiters);
+
 typedef struct {
   FILE *infile;
   const char *delimiters;
   bool discardDelimiters;
+  delimiterset delimiterSet;       // compiled from delimiters
+  char *cachedDelimiters[kSTCachedDelimiterSets]; // copies of other delimiter strings, or NULL
+  delimiterset cachedSets[kSTCachedDelimiterSets]; // compiled from cachedDelimiters
+  int nextCachedSet;               // the cache entry to be replaced next
+  STSpanFunction span;             // crosses runs of delimiters or non-delimiters
+  char *buffer;                    // the characters read ahead, or the mapped file
+  const char *cursor;              // the next character not yet handed out
+  const char *end;                 // just past the last character read ahead
+  size_t capacity;                 // the size of buffer, if it isn't mapped
+  size_t mappedLength;             // the length of the mapping, or 0 if buffer isn't one
+  long bufferOffset;               // where buffer[0] is in the file, or -1 if unknown
+  bool readLines;                  // true if buffer is filled a line at a time
 } streamtokenizer;
 
 /**
@@ -72,7 +134,11 @@ void STNew(streamtokenizer *st, FILE *infile, const char *delimiters, bool disca
  * Properly disposes of any resources acquired by
  * STNew.  The FILE * passed to STInitialize is 
  * *not* closed, because STInitialize didn't open any
- * files.
+ * files.  If the stream can seek, it's left positioned
+ * just after the last character the streamtokenizer
+ * handed out (or skipped), so the client can pick up
+ * reading from there.  Characters read ahead from a pipe
+ * or terminal are lost.
  */
 
 void STDispose(streamtokenizer *st);
@@ -145,6 +211,30 @@ bool STNextToken(streamtokenizer *st, char buffer[], int bufferLength);
 bool STNextTokenUsingDifferentDelimiters(streamtokenizer *st, char buffer[], int bufferLength,
 										 const char *delimiters);
 
+/**
+ * Function: STNextTokenSpan
+ * -------------------------
+ * Forms the next token exactly as STNextToken does, but rather than
+ * copying it into a client buffer, sets *token to the address of its
+ * first character, right where it sits in the streamtokenizer's own
+ * storage, and *length to the number of characters in it.  The token is
+ * not null-terminated, and it's only good until the next call to any
+ * streamtokenizer function.  Since no buffer can fill up, a long token
+ * is never chopped into pieces.
+ *
+ * Returns true if a token was found, and false (leaving *token and
+ * *length alone) under the same conditions STNextToken returns false.
+ *
+ *     const char *token;
+ *     int length;
+ *     while (STNextTokenSpan(&st, &token, &length))
+ *         printf("%.*s\n", length, token);
+ *
+ * STNextTokenSpan asserts that token and length are non-NULL.
+ */
+
+bool STNextTokenSpan(streamtokenizer *st, const char **token, int *length);
+
 /**
  * Function: STSkipOver
  * --------------------
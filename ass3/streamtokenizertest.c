@@ -0,0 +1,328 @@
+/**
+ * File: streamtokenizertest.c
+ * ---------------------------
+ * Tests for the streamtokenizer.  It includes streamtokenizer.c itself
+ * rather than linking against it, so that it can call the span
+ * functions, which are static, directly.  It prints a line per test
+ * and asserts everything it checks.
+ */
+
+#include "streamtokenizer.c"
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/**
+ * Function: ReferenceSpan
+ * -----------------------
+ * The span functions' specification, written as plainly as possible:
+ * a character is a delimiter if memchr finds it in the delimiter
+ * string, '\0' included.
+ */
+
+static const char *ReferenceSpan(const char *chars, const char *start, const char *end, bool delimiters)
+{
+  while (start < end && (memchr(chars, *start, strlen(chars) + 1) != NULL) == delimiters) start++;
+  return start;
+}
+
+/**
+ * Function: RandomDelimiters
+ * --------------------------
+ * Fills chars with between 1 and 24 random nonzero characters, about
+ * half of them 0x80 or above, and terminates it.
+ */
+
+static void RandomDelimiters(char chars[25])
+{
+  int n = 1 + rand() % 24;
+  for (int i = 0; i < n; i++) chars[i] = 1 + rand() % 255;
+  chars[n] = '\0';
+}
+
+/**
+ * Function: RandomText
+ * --------------------
+ * Fills text with n characters, each of them one of the delimiters
+ * with probability 1 / density and an arbitrary byte (0x80 and up
+ * and '\0' included) otherwise, so the runs the spans cross come in
+ * every length from none on up.
+ */
+
+static void RandomText(char *text, int n, const char *chars, int density)
+{
+  int numChars = strlen(chars);
+  for (int i = 0; i < n; i++)
+    text[i] = rand() % density == 0 ? chars[rand() % numChars] : rand() % 256;
+}
+
+/**
+ * Function: TestSpans
+ * -------------------
+ * Runs every span function this processor supports over random text
+ * with random delimiter sets, starting from every position in the text
+ * and looking for both kinds of run, and checks that each stops just
+ * where ReferenceSpan does.  The text lengths aren't all multiples of
+ * 16 or 32, so the vector loops hand over to the scalar tails at every
+ * offset.  The text always ends right at the end of a page, with a
+ * page that can't be read after it, so a span that read past end would
+ * crash the test.
+ */
+
+static void TestSpans(void)
+{
+  const int kMaxLength = 200, kNumTrials = 2000;
+  const char *kSpanNames[] = {"SpanScalar", "SpanSSSE3", "SpanAVX2"};
+  STSpanFunction spans[3] = {SpanScalar, NULL, NULL};
+#ifdef ST_SIMD_SCAN
+  if (__builtin_cpu_supports("ssse3")) spans[1] = SpanSSSE3;
+  if (__builtin_cpu_supports("avx2")) spans[2] = SpanAVX2;
+#endif
+
+  long pageSize = sysconf(_SC_PAGESIZE);
+  char *pages = mmap(NULL, 2 * pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(pages != MAP_FAILED);
+  int protected = mprotect(pages + pageSize, pageSize, PROT_NONE);
+  assert(protected == 0);
+
+  srand(1989);
+  for (int trial = 0; trial < kNumTrials; trial++) {
+    char chars[25];
+    delimiterset set;
+    int length = rand() % (kMaxLength + 1);
+    char *text = pages + pageSize - length;
+    RandomDelimiters(chars);
+    CompileDelimiters(&set, chars);
+    RandomText(text, length, chars, 1 + trial % 8);
+    for (int start = 0; start <= length; start++) {
+      for (int delimiters = 0; delimiters <= 1; delimiters++) {
+        const char *expected = ReferenceSpan(chars, text + start, text + length, delimiters);
+        for (int i = 0; i < 3; i++) {
+          if (spans[i] != NULL)
+            assert(spans[i](&set, text + start, text + length, delimiters) == expected);
+        }
+      }
+    }
+  }
+  munmap(pages, 2 * pageSize);
+
+  fprintf(stdout, "The span functions agreed on %d random texts:", kNumTrials);
+  for (int i = 0; i < 3; i++) {
+    if (spans[i] != NULL) fprintf(stdout, " %s", kSpanNames[i]);
+  }
+  fprintf(stdout, ".\n");
+}
+
+static const char *const kDelimiters = " \t\n.,";
+
+/**
+ * Function: BuildText
+ * -------------------
+ * Returns the text the I/O tests tokenize, which is kTextLength
+ * characters long.  Its first token ends a few characters short of the
+ * end of the first 64KB buffer load, so the second one straddles the
+ * boundary and has to be slid down by a refill.  Its
+ * third token is longer than two buffer loads, so the buffer has to
+ * double (twice) to hold it in one piece.  After that come short words
+ * separated by runs of delimiters, a line at a time.
+ */
+
+static const int kTextLength = 500000;
+
+static char *BuildText(void)
+{
+  char *text = malloc(kTextLength + 1);
+  assert(text != NULL);
+  int n = 0;
+  while (n < (int)kBufferSize - 6) text[n++] = 'a';
+  text[n++] = ' ';
+  for (const char *crossing = "crossing"; *crossing != '\0'; crossing++) text[n++] = *crossing;
+  text[n++] = '\n';
+  for (int i = 0; i < 5 * (int)kBufferSize / 2; i++) text[n++] = 'b' + i % 20;
+  while (n < kTextLength) {
+    int ch = rand() % 10;
+    text[n++] = ch < 6 ? 'a' + rand() % 26 : ch < 9 ? kDelimiters[rand() % 4] : '\n';
+  }
+  text[n] = '\0';
+  return text;
+}
+
+/**
+ * Function: ReferenceTokens
+ * -------------------------
+ * Writes the tokens of text to tokens, one per line, as STNextToken
+ * should hand them out with the specified buffer length, discarding
+ * delimiters: every maximal run of non-delimiters, split into pieces
+ * of at most bufferLength - 1 characters.
+ */
+
+static void ReferenceTokens(const char *text, int bufferLength, FILE *tokens)
+{
+  for (int length = 0; ; text++) {
+    if (*text != '\0' && strchr(kDelimiters, *text) == NULL) {
+      if (length == bufferLength - 1) {
+        fputc('\n', tokens);
+        length = 0;
+      }
+      fputc(*text, tokens);
+      length++;
+    } else if (length > 0) {
+      fputc('\n', tokens);
+      length = 0;
+    }
+    if (*text == '\0') return;
+  }
+}
+
+/**
+ * Function: ReadTokens
+ * --------------------
+ * Tokenizes infile with STNextToken, using a buffer of the specified
+ * length, and writes the tokens to tokens, one per line.  A
+ * bufferLength of 0 means to use STNextTokenSpan instead.
+ */
+
+static void ReadTokens(FILE *infile, int bufferLength, FILE *tokens)
+{
+  streamtokenizer st;
+  STNew(&st, infile, kDelimiters, true);
+  if (bufferLength == 0) {
+    const char *token;
+    int length;
+    while (STNextTokenSpan(&st, &token, &length)) fprintf(tokens, "%.*s\n", length, token);
+  } else {
+    char *buffer = malloc(bufferLength);
+    assert(buffer != NULL);
+    while (STNextToken(&st, buffer, bufferLength)) fprintf(tokens, "%s\n", buffer);
+    free(buffer);
+  }
+  STDispose(&st);
+}
+
+/**
+ * Function: OpenPipe
+ * ------------------
+ * Returns a stream reading from a pipe that a child process writes
+ * text into, in pieces of irregular sizes, and then closes.
+ */
+
+static FILE *OpenPipe(const char *text, pid_t *child)
+{
+  int fds[2];
+  int piped = pipe(fds);
+  assert(piped == 0);
+  *child = fork();
+  assert(*child >= 0);
+  if (*child == 0) {
+    close(fds[0]);
+    for (size_t written = 0, length = strlen(text), chunk = 1; written < length; chunk = chunk * 7 % 9973) {
+      ssize_t n = write(fds[1], text + written, chunk < length - written ? chunk : length - written);
+      if (n <= 0) _exit(1);
+      written += n;
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  FILE *infile = fdopen(fds[0], "r");
+  assert(infile != NULL);
+  return infile;
+}
+
+/**
+ * Function: TestTokens
+ * --------------------
+ * Tokenizes the text of BuildText from a pipe and from a regular file
+ * (which gets mapped), with buffers of length 2 (one character per
+ * token), 64, and enough for any token, and with STNextTokenSpan, and
+ * checks that both produce exactly the tokens ReferenceTokens does.
+ */
+
+static void TestTokens(void)
+{
+  const int kBufferLengths[] = {2, 64, kTextLength + 1, 0};
+  char *text = BuildText();
+  FILE *regular = tmpfile();
+  assert(regular != NULL);
+  fputs(text, regular);
+
+  for (int i = 0; i < 4; i++) {
+    char *expected, *piped, *mapped;
+    size_t expectedLength, pipedLength, mappedLength;
+    FILE *tokens = open_memstream(&expected, &expectedLength);
+    ReferenceTokens(text, kBufferLengths[i] == 0 ? kTextLength + 1 : kBufferLengths[i], tokens);
+    fclose(tokens);
+
+    pid_t child;
+    int status;
+    FILE *infile = OpenPipe(text, &child);
+    tokens = open_memstream(&piped, &pipedLength);
+    ReadTokens(infile, kBufferLengths[i], tokens);
+    fclose(tokens);
+    fclose(infile);
+    waitpid(child, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    rewind(regular);
+    tokens = open_memstream(&mapped, &mappedLength);
+    ReadTokens(regular, kBufferLengths[i], tokens);
+    fclose(tokens);
+
+    assert(pipedLength == expectedLength && memcmp(piped, expected, expectedLength) == 0);
+    assert(mappedLength == expectedLength && memcmp(mapped, expected, expectedLength) == 0);
+    free(expected);
+    free(piped);
+    free(mapped);
+  }
+  fclose(regular);
+  free(text);
+  fprintf(stdout, "Piped and regular files gave the same tokens, across buffer boundaries and with every buffer length.\n");
+}
+
+/**
+ * Function: TestDisposePosition
+ * -----------------------------
+ * Starts a tokenizer partway into a regular file (at an offset that
+ * isn't a multiple of the page size, so the mapping starts before the
+ * first character it hands out), takes a few tokens, and checks that
+ * STDispose leaves the stream at the first character it didn't hand
+ * out, for the client to go on reading from there.
+ */
+
+static void ExpectToken(streamtokenizer *st, const char *expected)
+{
+  char token[16];
+  bool found = STNextToken(st, token, sizeof(token));
+  assert(found && strcmp(token, expected) == 0);
+}
+
+static void TestDisposePosition(void)
+{
+  const char *contents = "skip this. alpha beta,  gamma delta\n";
+  streamtokenizer st;
+  FILE *infile = tmpfile();
+  assert(infile != NULL);
+  fputs(contents, infile);
+  fseek(infile, strlen("skip this."), SEEK_SET);
+
+  STNew(&st, infile, kDelimiters, true);
+  ExpectToken(&st, "alpha");
+  ExpectToken(&st, "beta");
+  STDispose(&st);
+  assert(ftell(infile) == strstr(contents, ",  gamma") - contents);
+  int next = getc(infile);
+  assert(next == ',');
+
+  STNew(&st, infile, kDelimiters, true);
+  ExpectToken(&st, "gamma");
+  STDispose(&st);
+  assert(ftell(infile) == strstr(contents, " delta") - contents);
+  fclose(infile);
+  fprintf(stdout, "STDispose left the file just past the last token handed out.\n");
+}
+
+int main(int unused, char **alsoUnused)
+{
+  TestSpans();
+  TestTokens();
+  TestDisposePosition();
+  return 0;
+}
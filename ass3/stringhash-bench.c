@@ -0,0 +1,135 @@
+/**
+ * File: stringhash-bench.c
+ * ------------------------
+ * Micro-benchmark comparing the multiplicative string hash the thesaurus
+ * and rss-news-search used to define for themselves against the ones in
+ * stringhash.h, for speed and for how evenly they spread strings over a
+ * hashset's buckets.  Two word lists are used: random lowercase words,
+ * and words that all share a prefix and differ only in a numeric suffix.
+ *
+ * Spread is reported as the chi-square statistic of the bucket counts
+ * divided by its degrees of freedom: 1.0 is what a truly random hash
+ * would score, anything much above that means crowded buckets, and
+ * anything much below it means the hash is tracking some regularity in
+ * the words (which happens to pay off on these words and to backfire on
+ * others).
+ *
+ *     ./stringhash-bench [number of words]
+ */
+
+#include "stringhash.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const int kDefaultNumWords = 200000;
+static const int kNumRounds = 20;
+static const int kBucketCounts[] = { 1021, 1024, 65536 };
+#define kNumBucketCounts (sizeof(kBucketCounts) / sizeof(kBucketCounts[0]))
+
+typedef unsigned long (*hashfn)(const char *s);
+
+/**
+ * Function: LegacyHash
+ * --------------------
+ * The hash both programs used to have, strlen call in the
+ * loop condition and all.
+ */
+
+static const signed long kHashMultiplier = -1664117991L;
+static unsigned long LegacyHash(const char *s)
+{
+  unsigned long hashcode = 0;
+  for (int i = 0; i < strlen(s); i++)
+    hashcode = hashcode * kHashMultiplier + tolower(s[i]);
+  return hashcode;
+}
+
+static unsigned long LegacyHashOneStrlen(const char *s)
+{
+  unsigned long hashcode = 0;
+  for (size_t i = 0, length = strlen(s); i < length; i++)
+    hashcode = hashcode * kHashMultiplier + tolower(s[i]);
+  return hashcode;
+}
+
+static unsigned long WordAtATimeHash(const char *s)
+{ return StringHash(s, strlen(s)); }
+
+static unsigned long WordAtATimeHashIgnoringCase(const char *s)
+{ return StringHashIgnoringCase(s, strlen(s)); }
+
+static double Now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double ChiSquarePerDegree(hashfn hash, char **words, int numWords, int numBuckets)
+{
+  int *counts = calloc(numBuckets, sizeof(int));
+  for (int i = 0; i < numWords; i++) counts[hash(words[i]) % numBuckets]++;
+  double expected = (double)numWords / numBuckets, chiSquare = 0;
+  for (int i = 0; i < numBuckets; i++) chiSquare += (counts[i] - expected) * (counts[i] - expected) / expected;
+  free(counts);
+  return chiSquare / (numBuckets - 1);
+}
+
+static void Benchmark(const char *name, hashfn hash, char **words, int numWords)
+{
+  unsigned long checksum = 0;
+  double start = Now();
+  for (int round = 0; round < kNumRounds; round++)
+    for (int i = 0; i < numWords; i++) checksum += hash(words[i]);
+  double seconds = Now() - start;
+
+  printf("%-26s %7.2f ns/hash %8.1f M hashes/s   chi-square/df:", name,
+         seconds * 1e9 / numWords / kNumRounds, numWords * kNumRounds / seconds / 1e6);
+  for (int i = 0; i < kNumBucketCounts; i++)
+    printf(" %6.2f (%d)", ChiSquarePerDegree(hash, words, numWords, kBucketCounts[i]), kBucketCounts[i]);
+  printf("   (checksum %lu)\n", checksum % 1000000);
+}
+
+static void BenchmarkAll(const char *title, char **words, int numWords)
+{
+  printf("\n%s:\n", title);
+  Benchmark("legacy", LegacyHash, words, numWords);
+  Benchmark("legacy, strlen hoisted", LegacyHashOneStrlen, words, numWords);
+  Benchmark("StringHash", WordAtATimeHash, words, numWords);
+  Benchmark("StringHashIgnoringCase", WordAtATimeHashIgnoringCase, words, numWords);
+}
+
+int main(int argc, char *argv[])
+{
+  int numWords = (argc > 1) ? atoi(argv[1]) : kDefaultNumWords;
+  if (numWords <= 0) {
+    fprintf(stderr, "Usage: stringhash-bench [number of words]\n");
+    return 1;
+  }
+
+  char **words = malloc(numWords * sizeof(char *));
+  srand(1);
+  for (int i = 0; i < numWords; i++) {
+    char word[32];
+    int length = 3 + rand() % 12;
+    for (int j = 0; j < length; j++) word[j] = 'a' + rand() % 26;
+    word[length] = '\0';
+    words[i] = strdup(word);
+  }
+  BenchmarkAll("Random lowercase words, 3 to 14 letters", words, numWords);
+
+  for (int i = 0; i < numWords; i++) {
+    char word[32];
+    sprintf(word, "synonym-%06d", i);
+    free(words[i]);
+    words[i] = strdup(word);
+  }
+  BenchmarkAll("Words of the form synonym-000000", words, numWords);
+
+  for (int i = 0; i < numWords; i++) free(words[i]);
+  free(words);
+  return 0;
+}
@@ -2,10 +2,10 @@
 #include "hashset.h"
 #include "vector.h"
 #include "streamtokenizer.h"
+#include "stringhash.h"
 #include <stdlib.h>  // for malloc, free, etc
 #include <string.h>  // for strcmp
 #include <strings.h>
-#include <ctype.h>   // for tolower
 #include <time.h>    // for time
 
 /**
@@ -20,28 +20,6 @@ typedef struct {
   vector synonyms;
 } thesaurusEntry;
 
-/**
- * Hash function provided by the goddess of lecturing,
- * Julie Zelenski.  I'm not sure where it came from, but
- * I'm guessing the multiplier is standard.
- *
- * @param elem a void * which is understood to be the address
- *             of a char *, which itself addresses the first of
- *             a series of characters making up a C string.
- * @param numBuckets the number of buckets in the hash table.
- * @return the hashcode of the C string addressed by elem.
- */
-
-static const signed long kHashMultiplier = -1664117991L;
-static int StringHash(const void *elem, int numBuckets)
-{
-  char *s = *(char **) elem;
-  unsigned long hashcode = 0;
-  for (int i = 0; i < strlen(s); i++)  
-    hashcode = hashcode * kHashMultiplier + tolower(s[i]);  
-  return hashcode % numBuckets;                                  
-}
-
 /**
  * Compares the two C strings planted at the specified addresses.
  * elem1 and elem2 are statically identified as void *s, but 
@@ -115,16 +93,21 @@ static void TokenizeAndBuildThesaurus(hashset *thesaurus, streamtokenizer *st)
   printf("Loading thesaurus. Be patient! ");
   fflush(stdout);
 
-  char buffer[2048];
-  while (STNextToken(st, buffer, sizeof(buffer))) {
+  const char *token; // each token is read in place, and only copied once it's kept
+  int length;
+  vector synonyms; // collects each line's synonyms, which are then copied over in one go
+  VectorNew(&synonyms, sizeof(char *), NULL, 0);
+  while (STNextTokenSpan(st, &token, &length)) {
     thesaurusEntry entry;
-    entry.word = strdup(buffer);
-    VectorNew(&entry.synonyms, sizeof(char *), StringFree, 4);
-    while (STNextToken(st, buffer, sizeof(buffer)) && (buffer[0] == ',')) {
-      STNextToken(st, buffer, sizeof(buffer));
-      char *synonym = strdup(buffer);
-      VectorAppend(&entry.synonyms, &synonym);
+    entry.word = strndup(token, length);
+    while (STNextTokenSpan(st, &token, &length) && (token[0] == ',')) {
+      STNextTokenSpan(st, &token, &length);
+      char *synonym = strndup(token, length);
+      VectorAppend(&synonyms, &synonym);
     }
+    VectorNew(&entry.synonyms, sizeof(char *), StringFree, VectorLength(&synonyms));
+    VectorAppendN(&entry.synonyms, VectorData(&synonyms), VectorLength(&synonyms));
+    VectorDeleteRange(&synonyms, 0, VectorLength(&synonyms));
     HashSetEnter(thesaurus, &entry);
     if (HashSetCount(thesaurus) % 1000 == 0) {
       printf(".");
@@ -132,6 +115,7 @@ static void TokenizeAndBuildThesaurus(hashset *thesaurus, streamtokenizer *st)
     }
   }
 
+  VectorDispose(&synonyms);
   printf(" [All done!]\n");
   fflush(stdout);
 }
@@ -217,17 +201,25 @@ static void QueryThesaurus(hashset *thesaurus)
 }
 
 /**
- * Provides the enty point to the program.
+ * Provides the enty point to the program.  Passing --stats ahead of
+ * the (optional) thesaurus file name prints the hashset's statistics
+ * once the thesaurus has been loaded.
  */
 
-static const int kApproximateWordCount = (1 << 19) - 1; // six-digit Marsenne prime
+static const int kInitialBucketCount = 1021; // the hashset grows as the thesaurus is read
 int main(int argc, const char *argv[])
 {
   hashset thesaurus;
-  HashSetNew(&thesaurus, sizeof(thesaurusEntry), kApproximateWordCount, StringHash, StringCompare, ThesEntryFree);
+  HashSetNewOpenAddressing(&thesaurus, sizeof(thesaurusEntry), kInitialBucketCount, StringHashElement, StringCompare, ThesEntryFree);
+  bool printStats = (argc > 1 && strcmp(argv[1], "--stats") == 0);
+  if (printStats) {
+    argc--;
+    argv++;
+  }
   const char *thesaurusFileName = (argc == 1) ? 
     "/usr/class/cs107/assignments/assn-3-vector-hashset-data/thesaurus.txt" : argv[1];
   ReadThesaurus(&thesaurus, thesaurusFileName);
+  if (printStats) HashSetPrintStats(&thesaurus, "thesaurus", stdout);
   QueryThesaurus(&thesaurus);
   HashSetDispose(&thesaurus);
   return 0;
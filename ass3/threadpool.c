@@ -0,0 +1,120 @@
+#include "threadpool.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The pool's lock guards everything but workers and num_workers.  A job
+ * is taken apart one task number at a time: a thread claims next_task
+ * while holding the lock, runs it without the lock, and then counts it
+ * off num_unfinished, and whichever thread counts off the last one
+ * wakes up the thread that's running the job.  Between jobs, next_task
+ * equals num_tasks (both 0), so idle workers find nothing to claim and
+ * wait on tasks_available.
+ */
+
+static const int kTasksPerThread = 4;
+
+/*
+ * Runs tasks until there are none left to claim.  Called, and
+ * returns, with the lock held.
+ */
+
+static void RunTasks(threadpool *p)
+{
+	while (p->next_task < p->num_tasks) {
+		int task = p->next_task++;
+		ThreadPoolTaskFunction taskfn = p->taskfn;
+		void *auxData = p->aux_data;
+		pthread_mutex_unlock(&p->lock);
+		taskfn(task, auxData);
+		pthread_mutex_lock(&p->lock);
+		if (--p->num_unfinished == 0) pthread_cond_signal(&p->tasks_finished);
+	}
+}
+
+static void *Worker(void *data)
+{
+	threadpool *p = data;
+	pthread_mutex_lock(&p->lock);
+	while (true) {
+		while (!p->shutting_down && p->next_task == p->num_tasks)
+			pthread_cond_wait(&p->tasks_available, &p->lock);
+		if (p->shutting_down) break;
+		RunTasks(p);
+	}
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+void ThreadPoolNew(threadpool *p, int numThreads)
+{
+	assert(numThreads > 0);
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->tasks_available, NULL);
+	pthread_cond_init(&p->tasks_finished, NULL);
+	p->taskfn = NULL;
+	p->aux_data = NULL;
+	p->num_tasks = p->next_task = p->num_unfinished = 0;
+	p->shutting_down = false;
+	p->num_workers = numThreads - 1;
+	p->workers = malloc((p->num_workers + 1) * sizeof(pthread_t));
+	assert(p->workers != NULL);
+	for (int i = 0; i < p->num_workers; i++) {
+		int err = pthread_create(&p->workers[i], NULL, Worker, p);
+		if (err != 0) {
+			fprintf(stderr, "ThreadPoolNew: couldn't start thread %d of %d: %s\n", i + 2, numThreads, strerror(err));
+			abort();
+		}
+	}
+}
+
+void ThreadPoolDispose(threadpool *p)
+{
+	pthread_mutex_lock(&p->lock);
+	assert(p->num_unfinished == 0);
+	p->shutting_down = true;
+	pthread_cond_broadcast(&p->tasks_available);
+	pthread_mutex_unlock(&p->lock);
+	for (int i = 0; i < p->num_workers; i++) pthread_join(p->workers[i], NULL);
+	free(p->workers);
+	pthread_cond_destroy(&p->tasks_finished);
+	pthread_cond_destroy(&p->tasks_available);
+	pthread_mutex_destroy(&p->lock);
+}
+
+int ThreadPoolSize(const threadpool *p)
+{ return p->num_workers + 1; }
+
+void ThreadPoolRun(threadpool *p, int numTasks, ThreadPoolTaskFunction taskfn, void *auxData)
+{
+	assert(taskfn != NULL);
+	assert(numTasks >= 0);
+	if (numTasks == 0) return;
+	pthread_mutex_lock(&p->lock);
+	assert(p->num_unfinished == 0);
+	p->taskfn = taskfn;
+	p->aux_data = auxData;
+	p->num_tasks = p->num_unfinished = numTasks;
+	p->next_task = 0;
+	if (numTasks > 1) pthread_cond_broadcast(&p->tasks_available);
+	RunTasks(p);
+	while (p->num_unfinished > 0) pthread_cond_wait(&p->tasks_finished, &p->lock);
+	p->num_tasks = p->next_task = 0;
+	pthread_mutex_unlock(&p->lock);
+}
+
+int ThreadPoolNumTasks(const threadpool *p, int numItems)
+{
+	int numTasks = ThreadPoolSize(p) == 1 ? 1 : kTasksPerThread * ThreadPoolSize(p);
+	if (numTasks > numItems) numTasks = numItems;
+	return numTasks > 0 ? numTasks : 1;
+}
+
+void ThreadPoolTaskRange(int task, int numTasks, int numItems, int *start, int *end)
+{
+	assert(task >= 0 && task < numTasks);
+	*start = (long long)numItems * task / numTasks;
+	*end = (long long)numItems * (task + 1) / numTasks;
+}
@@ -0,0 +1,116 @@
+#ifndef _threadpool_
+#define _threadpool_
+#include "bool.h"
+#include <pthread.h>
+
+/* File: threadpool.h
+ * ------------------
+ * Defines the interface for the threadpool, a fixed set of threads that
+ * share out the tasks of one job at a time.  The threads are started
+ * once, when the pool is created, and sleep between jobs, so a job only
+ * costs waking them up rather than creating them.  The thread that
+ * runs a job works on its tasks too, and returns once every task is
+ * done.  VectorMapParallel, HashSetMapParallel and their MapReduce
+ * cousins are built on it.
+ */
+
+/**
+ * Type: ThreadPoolTaskFunction
+ * ----------------------------
+ * Class of function that carries out the tasks of a job.  It's called
+ * once for each task number from 0 up to (but not including) the
+ * number of tasks, along with the auxData passed to ThreadPoolRun.
+ * Calls for different tasks may come from different threads at the same
+ * time and in any order, so the function must be thread-safe: whatever
+ * it writes must either belong to its task alone or be protected.
+ */
+
+typedef void (*ThreadPoolTaskFunction)(int task, void *auxData);
+
+/**
+ * Type: threadpool
+ * ----------------
+ * The concrete representation of the threadpool.  As with the
+ * other containers, clients should only ever go through the functions
+ * below.
+ */
+
+typedef struct {
+  pthread_t *workers;
+  int num_workers;
+  pthread_mutex_t lock;
+  pthread_cond_t tasks_available;
+  pthread_cond_t tasks_finished;
+  ThreadPoolTaskFunction taskfn;
+  void *aux_data;
+  int num_tasks;
+  int next_task;
+  int num_unfinished;
+  bool shutting_down;
+} threadpool;
+
+/**
+ * Function: ThreadPoolNew
+ * -----------------------
+ * Initializes the identified threadpool so that jobs are run on
+ * numThreads threads, counting the one that calls ThreadPoolRun, which
+ * means numThreads - 1 new threads are started.  A pool of one thread
+ * runs every job on the calling thread.  An assert is raised if
+ * numThreads is less than 1, and the program is aborted, with a message
+ * saying why, if one of the threads can't be started.
+ */
+
+void ThreadPoolNew(threadpool *p, int numThreads);
+
+/**
+ * Function: ThreadPoolDispose
+ * ---------------------------
+ * Stops the pool's threads and frees its resources.  No job may be
+ * running at the time.
+ */
+
+void ThreadPoolDispose(threadpool *p);
+
+/**
+ * Function: ThreadPoolSize
+ * ------------------------
+ * Returns the number of threads jobs run on, as passed to ThreadPoolNew.
+ */
+
+int ThreadPoolSize(const threadpool *p);
+
+/**
+ * Function: ThreadPoolRun
+ * -----------------------
+ * Calls taskfn once for every task number in [0, numTasks), spreading
+ * the calls over the pool's threads, and returns once they've all
+ * returned.  Everything taskfn wrote is visible to the caller by then.
+ * Only one job can run on a pool at a time, and taskfn must not run
+ * another job on the same pool.  An assert is raised if taskfn is NULL,
+ * if numTasks is negative, or if another job is already running.
+ */
+
+void ThreadPoolRun(threadpool *p, int numTasks, ThreadPoolTaskFunction taskfn, void *auxData);
+
+/**
+ * Function: ThreadPoolNumTasks
+ * ----------------------------
+ * Returns how many tasks a job over numItems independent items (vector
+ * elements, say) should be split into: a few per thread, so that a
+ * thread that finishes early can pick up some of the slack, but never
+ * more than there are items, and never less than one.
+ */
+
+int ThreadPoolNumTasks(const threadpool *p, int numItems);
+
+/**
+ * Function: ThreadPoolTaskRange
+ * -----------------------------
+ * Splits numItems items into numTasks contiguous ranges that differ in
+ * length by at most one, and sets *start and *end so that task number
+ * task covers items [*start, *end).
+ */
+
+void ThreadPoolTaskRange(int task, int numTasks, int numItems, int *start, int *end);
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef _typedhashset_
+#define _typedhashset_
+#include "hashset.h"
+#include "hashsetgroup.h"
+#include <limits.h>
+
+/* File: typedhashset.h
+ * --------------------
+ * Defines the DEFINE_TYPED_HASHSET macro, which generates a flavor of the
+ * open-addressing hashset specialized to a single element type, with its
+ * hash and equality functions known at compile time.  Lookups (which is
+ * to say most operations) are compiled into straight-line probing code
+ * with the hash and equality tests inlined, rather than going through
+ * hashfn and comparefn pointers and void *s.
+ */
+
+/**
+ * Macro: DEFINE_TYPED_HASHSET
+ * ---------------------------
+ * DEFINE_TYPED_HASHSET(Name, T, Hash, Equal) defines the type Name, a
+ * hashset of elements of type T, and NameElement as another name for T
+ * (so that const NameElement * means what it should even when T is a
+ * pointer type).  Hash and Equal name functions (ideally static inline
+ * ones) of the forms
+ *
+ *     unsigned Hash(const NameElement *elem);
+ *     bool Equal(const NameElement *elem1, const NameElement *elem2);
+ *
+ * The macro also defines the following static inline functions:
+ *
+ *     void NameNew(Name *ts, int numBuckets, HashSetFreeFunction freefn);
+ *     void NameDispose(Name *ts);
+ *     int NameCount(const Name *ts);
+ *     void NameEnter(Name *ts, const NameElement *elem);
+ *     NameElement *NameLookup(const Name *ts, const NameElement *elem);
+ *     NameElement *NameFindOrInsert(Name *ts, const NameElement *elem, bool *inserted);
+ *     void NameMap(Name *ts, HashSetMapFunction mapfn, void *auxData);
+ *
+ * Each behaves just like the hashset function of the same name applied
+ * to a hashset created by HashSetNewOpenAddressing.  A Name is such a
+ * hashset underneath (its h field), so any other hashset function can be
+ * applied to &ts->h.  NameFindOrInsert (and so NameEnter) probes the
+ * table just once, inline, and enters the element into the empty slot
+ * that ends the probe if there's no match.  Only when the table has to
+ * grow first does it call out to hashset.c, handing over the hash code
+ * it's already computed; hashset.c sees Hash and Equal through generated
+ * wrappers.
+ */
+
+#define DEFINE_TYPED_HASHSET(Name, T, Hash, Equal)                                          \
+typedef T Name##Element;                                                                    \
+typedef struct {                                                                            \
+    hashset h;                                                                              \
+} Name;                                                                                     \
+                                                                                            \
+static int Name##HashFunction(const void *elemAddr, int numBuckets)                         \
+{ return Hash((const Name##Element *)elemAddr) % (unsigned)numBuckets; }                    \
+                                                                                            \
+static int Name##CompareFunction(const void *elemAddr1, const void *elemAddr2)              \
+{ return !Equal((const Name##Element *)elemAddr1, (const Name##Element *)elemAddr2); }      \
+                                                                                            \
+static inline void Name##New(Name *ts, int numBuckets, HashSetFreeFunction freefn)          \
+{                                                                                           \
+    HashSetNewOpenAddressing(&ts->h, sizeof(T), numBuckets,                                 \
+            Name##HashFunction, Name##CompareFunction, freefn);                             \
+}                                                                                           \
+                                                                                            \
+static inline void Name##Dispose(Name *ts)                                                  \
+{ HashSetDispose(&ts->h); }                                                                 \
+                                                                                            \
+static inline int Name##Count(const Name *ts)                                               \
+{ return HashSetCount(&ts->h); }                                                            \
+                                                                                            \
+static inline Name##Element *Name##Lookup(const Name *ts, const Name##Element *elem)        \
+{                                                                                           \
+    int hash = Hash(elem) % (unsigned)INT_MAX;                                              \
+    unsigned char tag = HashSetTag(hash);                                                   \
+    for (int group = HashSetFirstGroup(ts->h.capacity, hash), step = 1; ;                   \
+            group = HashSetNextGroup(ts->h.capacity, group, step++)) {                      \
+        const unsigned char *ctrl = ts->h.ctrl + group * kHashSetGroupWidth;                \
+        unsigned match = HashSetGroupMatch(ctrl, tag);                                      \
+        for (; match != 0; match &= match - 1) {                                            \
+            int index = group * kHashSetGroupWidth + __builtin_ctz(match);                  \
+            Name##Element *candidate = (Name##Element *)ts->h.slots + index;                \
+            if (ts->h.hashes[index] == hash && Equal(elem, candidate)) return candidate;    \
+        }                                                                                   \
+        if (HashSetGroupMatch(ctrl, kHashSetEmpty) != 0) return NULL;                       \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+static inline Name##Element *Name##FindOrInsert(Name *ts, const Name##Element *elem,        \
+                                                  bool *inserted)                           \
+{                                                                                           \
+    int hash = Hash(elem) % (unsigned)INT_MAX;                                              \
+    if (HashSetMustGrow(ts->h.num_elems, ts->h.capacity))                                   \
+        return HashSetFindOrInsertHashed(&ts->h, elem, hash, inserted);                     \
+    unsigned char tag = HashSetTag(hash);                                                   \
+    for (int group = HashSetFirstGroup(ts->h.capacity, hash), step = 1; ;                   \
+            group = HashSetNextGroup(ts->h.capacity, group, step++)) {                      \
+        unsigned char *ctrl = ts->h.ctrl + group * kHashSetGroupWidth;                      \
+        unsigned match = HashSetGroupMatch(ctrl, tag);                                      \
+        for (; match != 0; match &= match - 1) {                                            \
+            int index = group * kHashSetGroupWidth + __builtin_ctz(match);                  \
+            Name##Element *candidate = (Name##Element *)ts->h.slots + index;                \
+            if (ts->h.hashes[index] == hash && Equal(elem, candidate)) {                    \
+                if (inserted != NULL) *inserted = false;                                    \
+                return candidate;                                                           \
+            }                                                                               \
+        }                                                                                   \
+        unsigned empty = HashSetGroupMatch(ctrl, kHashSetEmpty);                            \
+        if (empty != 0) {                                                                   \
+            int index = group * kHashSetGroupWidth + __builtin_ctz(empty);                  \
+            Name##Element *slot = (Name##Element *)ts->h.slots + index;                     \
+            ctrl[__builtin_ctz(empty)] = tag;                                               \
+            ts->h.hashes[index] = hash;                                                     \
+            *slot = *elem;                                                                  \
+            ts->h.num_elems++;                                                              \
+            if (inserted != NULL) *inserted = true;                                         \
+            return slot;                                                                    \
+        }                                                                                   \
+    }                                                                                       \
+}                                                                                           \
+                                                                                            \
+static inline void Name##Enter(Name *ts, const Name##Element *elem)                         \
+{                                                                                           \
+    bool inserted;                                                                          \
+    Name##Element *slot = Name##FindOrInsert(ts, elem, &inserted);                          \
+    if (inserted) return;                                                                   \
+    if (ts->h.freefn != NULL) ts->h.freefn(slot);                                           \
+    *slot = *elem;                                                                          \
+}                                                                                           \
+                                                                                            \
+static inline void Name##Map(Name *ts, HashSetMapFunction mapfn, void *auxData)             \
+{ HashSetMap(&ts->h, mapfn, auxData); }
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef _typedvector_
+#define _typedvector_
+#include "vector.h"
+#include <assert.h>
+
+/* File: typedvector.h
+ * -------------------
+ * Defines the DEFINE_TYPED_VECTOR macro, which generates a flavor of the
+ * vector specialized to a single element type.  The generic vector moves
+ * every element through a void * with a memcpy of elem_size bytes; the
+ * typed flavor reads and writes elements as values of their own type, so
+ * the compiler can inline the common operations and copy a small element
+ * in a register or two.
+ */
+
+/**
+ * Macro: DEFINE_TYPED_VECTOR
+ * --------------------------
+ * DEFINE_TYPED_VECTOR(Name, T) defines the type Name, a vector of
+ * elements of type T, and NameElement as another name for T (so that
+ * const NameElement * means what it should even when T is a pointer
+ * type), along with the following static inline functions:
+ *
+ *     void NameNew(Name *tv, VectorFreeFunction freefn, int initialAllocation);
+ *     void NameDispose(Name *tv);
+ *     int NameLength(const Name *tv);
+ *     T *NameNth(const Name *tv, int position);
+ *     void NameAppend(Name *tv, T elem);
+ *     void NameReplace(Name *tv, T elem, int position);
+ *     void NameMap(Name *tv, VectorMapFunction mapfn, void *auxData);
+ *
+ * Each behaves just like the vector function of the same name, asserts
+ * and all, except that elements are passed by value.  A Name is a plain
+ * vector underneath (its v field), so any other vector function can be
+ * applied to &tv->v.
+ */
+
+#define DEFINE_TYPED_VECTOR(Name, T)                                            \
+typedef T Name##Element;                                                        \
+typedef struct {                                                                \
+    vector v;                                                                   \
+} Name;                                                                         \
+                                                                                \
+static inline void Name##New(Name *tv, VectorFreeFunction freefn,               \
+                             int initialAllocation)                             \
+{ VectorNew(&tv->v, sizeof(T), freefn, initialAllocation); }                    \
+                                                                                \
+static inline void Name##Dispose(Name *tv)                                      \
+{ VectorDispose(&tv->v); }                                                      \
+                                                                                \
+static inline int Name##Length(const Name *tv)                                  \
+{ return tv->v.log_len; }                                                       \
+                                                                                \
+static inline T *Name##Nth(const Name *tv, int position)                        \
+{                                                                               \
+    assert(position >= 0 && position < tv->v.log_len);                          \
+    return (T *)VectorData(&tv->v) + position;                                  \
+}                                                                               \
+                                                                                \
+static inline void Name##Append(Name *tv, T elem)                               \
+{                                                                               \
+    if (tv->v.log_len < tv->v.alloc_len) {                                      \
+        ((T *)VectorData(&tv->v))[tv->v.log_len++] = elem;                      \
+    } else {                                                                    \
+        VectorAppend(&tv->v, &elem);                                            \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+static inline void Name##Replace(Name *tv, T elem, int position)                \
+{                                                                               \
+    T *dest = Name##Nth(tv, position);                                          \
+    if (tv->v.free_fn != NULL) tv->v.free_fn(dest);                             \
+    *dest = elem;                                                               \
+}                                                                               \
+                                                                                \
+static inline void Name##Map(Name *tv, VectorMapFunction mapfn, void *auxData)  \
+{ VectorMap(&tv->v, mapfn, auxData); }
+
+#define kTypedSortInsertionSortThreshold 16
+#define kTypedSortNintherThreshold 128
+#define kTypedSortPartialInsertionSortLimit 8
+
+/**
+ * Macro: DEFINE_TYPED_VECTOR_SORT
+ * -------------------------------
+ * DEFINE_TYPED_VECTOR_SORT(Name, Less) defines
+ *
+ *     void NameSort(Name *tv);
+ *
+ * for a Name already defined by DEFINE_TYPED_VECTOR.  Less names a
+ * function (ideally a static inline one) of the form
+ *
+ *     bool Less(const NameElement *elem1, const NameElement *elem2);
+ *
+ * that says whether elem1 belongs strictly before elem2.  NameSort sorts
+ * the vector with the same algorithm VectorSort uses, but with Less
+ * inlined and elements moved as values of their own type, which makes it
+ * several times faster than VectorSort for small elements.
+ */
+
+#define DEFINE_TYPED_VECTOR_SORT(Name, Less)                                    \
+static inline void Name##InsertionSort(Name##Element *elems, int n)             \
+{                                                                               \
+    for (int i = 1; i < n; i++) {                                               \
+        Name##Element elem = elems[i];                                          \
+        int j = i;                                                              \
+        for (; j > 0 && Less(&elem, &elems[j - 1]); j--)                        \
+            elems[j] = elems[j - 1];                                            \
+        elems[j] = elem;                                                        \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+static inline bool Name##PartialInsertionSort(Name##Element *elems, int n)      \
+{                                                                               \
+    int moves = 0;                                                              \
+    for (int i = 1; i < n; i++) {                                               \
+        if (!Less(&elems[i], &elems[i - 1])) continue;                          \
+        Name##Element elem = elems[i];                                          \
+        int j = i;                                                              \
+        for (; j > 0 && Less(&elem, &elems[j - 1]); j--)                        \
+            elems[j] = elems[j - 1];                                            \
+        elems[j] = elem;                                                        \
+        moves += i - j;                                                         \
+        if (moves > kTypedSortPartialInsertionSortLimit) return false;          \
+    }                                                                           \
+    return true;                                                                \
+}                                                                               \
+                                                                                \
+static inline void Name##SiftDown(Name##Element *elems, int root, int n)        \
+{                                                                               \
+    Name##Element elem = elems[root];                                           \
+    for (int child; (child = 2 * root + 1) < n; root = child) {                 \
+        if (child + 1 < n && Less(&elems[child], &elems[child + 1])) child++;   \
+        if (!Less(&elem, &elems[child])) break;                                 \
+        elems[root] = elems[child];                                             \
+    }                                                                           \
+    elems[root] = elem;                                                         \
+}                                                                               \
+                                                                                \
+static inline void Name##Swap(Name##Element *a, Name##Element *b)               \
+{ Name##Element tmp = *a; *a = *b; *b = tmp; }                                  \
+                                                                                \
+static inline void Name##Sort3(Name##Element *a, Name##Element *b,              \
+                               Name##Element *c)                                \
+{                                                                               \
+    if (Less(b, a)) Name##Swap(a, b);                                           \
+    if (Less(c, b)) {                                                           \
+        Name##Swap(b, c);                                                       \
+        if (Less(b, a)) Name##Swap(a, b);                                       \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+static inline void Name##IntroSort(Name##Element *elems, int n, int depthLimit) \
+{                                                                               \
+    while (n > kTypedSortInsertionSortThreshold) {                              \
+        if (depthLimit-- == 0) {                                                \
+            for (int i = n / 2 - 1; i >= 0; i--) Name##SiftDown(elems, i, n);   \
+            for (int i = n - 1; i > 0; i--) {                                   \
+                Name##Swap(&elems[0], &elems[i]);                               \
+                Name##SiftDown(elems, 0, i);                                    \
+            }                                                                   \
+            return;                                                             \
+        }                                                                       \
+        int mid = n / 2;                                                        \
+        Name##Sort3(&elems[0], &elems[mid], &elems[n - 1]);                     \
+        if (n > kTypedSortNintherThreshold) {                                   \
+            Name##Sort3(&elems[1], &elems[mid - 1], &elems[n - 2]);             \
+            Name##Sort3(&elems[2], &elems[mid + 1], &elems[n - 3]);             \
+            Name##Sort3(&elems[mid - 1], &elems[mid], &elems[mid + 1]);         \
+        }                                                                       \
+        Name##Swap(&elems[0], &elems[mid]);                                     \
+        Name##Element pivot = elems[0];                                         \
+        int i = 1, j = n - 1;                                                   \
+        bool moved = false;                                                     \
+        for (;;) {                                                              \
+            while (Less(&elems[i], &pivot)) i++;                                \
+            while (Less(&pivot, &elems[j])) j--;                                \
+            if (i >= j) break;                                                  \
+            Name##Swap(&elems[i++], &elems[j--]);                               \
+            moved = true;                                                       \
+        }                                                                       \
+        Name##Swap(&elems[0], &elems[j]);                                       \
+                                                                                \
+        Name##Element *right = elems + j + 1;                                   \
+        int numRight = n - j - 1;                                               \
+        if (!moved && Name##PartialInsertionSort(elems, j) &&                   \
+            Name##PartialInsertionSort(right, numRight)) return;                \
+        if (j < numRight) {                                                     \
+            Name##IntroSort(elems, j, depthLimit);                              \
+            elems = right;                                                      \
+            n = numRight;                                                       \
+        } else {                                                                \
+            Name##IntroSort(right, numRight, depthLimit);                       \
+            n = j;                                                              \
+        }                                                                       \
+    }                                                                           \
+    Name##InsertionSort(elems, n);                                              \
+}                                                                               \
+                                                                                \
+static inline void Name##Sort(Name *tv)                                         \
+{                                                                               \
+    int depthLimit = 0;                                                         \
+    for (int n = tv->v.log_len; n > 1; n >>= 1) depthLimit += 2;                \
+    Name##IntroSort((Name##Element *)VectorData(&tv->v), tv->v.log_len,        \
+                    depthLimit);                                                \
+}
+
+#endif
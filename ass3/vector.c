@@ -2,33 +2,99 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #include <search.h>
+#include <pthread.h>
 
 #define DEFAULT_ALLOC_LEN 4
+#define DEFAULT_GROWTH_FACTOR 2.0
+
+static bool IsInline(const vector *v)
+{
+    return (size_t)v->alloc_len * v->elem_size <= kVectorInlineBytes;
+}
+
+/*
+ * Moves the elements into storage for exactly allocLen elements, or into
+ * the inline storage if allocLen of them fit there (in which case the
+ * allocated length becomes however many fit).  allocLen must be at least
+ * the logical length.
+ */
+
+static void Reallocate(vector *v, int allocLen)
+{
+    assert(allocLen >= v->log_len);
+    size_t usedBytes = (size_t)v->log_len * v->elem_size;
+    bool toInline = (size_t)allocLen * v->elem_size <= kVectorInlineBytes;
+    if (toInline) allocLen = kVectorInlineBytes / v->elem_size;
+
+    if (IsInline(v) && !toInline) {
+        void *elems = malloc((size_t)allocLen * v->elem_size);
+        assert(elems != NULL);
+        memcpy(elems, v->storage.inline_elems, usedBytes);
+        v->storage.elems = elems;
+    } else if (!IsInline(v) && toInline) {
+        void *elems = v->storage.elems;
+        memcpy(v->storage.inline_elems, elems, usedBytes);
+        free(elems);
+    } else if (!IsInline(v)) {
+        v->storage.elems = realloc(v->storage.elems, (size_t)allocLen * v->elem_size);
+        assert(v->storage.elems != NULL);
+    }
+    v->alloc_len = allocLen;
+}
+
+/*
+ * Makes room for at least minAllocation elements, growing by the growth
+ * factor (or by more, if that isn't enough) when there isn't already.
+ */
+
+static void Grow(vector *v, int minAllocation)
+{
+    if (minAllocation <= v->alloc_len) return;
+    int allocLen = v->alloc_len * v->growth_factor;
+    Reallocate(v, (allocLen > minAllocation) ? allocLen : minAllocation);
+}
 
 void VectorNew(vector *v, int elemSize, VectorFreeFunction freeFn, int initialAllocation) 
 {
     assert(elemSize > 0);
     assert(initialAllocation >= 0);
     v->elem_size = elemSize;
-    v->alloc_len = (initialAllocation == 0) ? DEFAULT_ALLOC_LEN : initialAllocation;;
+    v->alloc_len = 0;
     v->log_len = 0;
-    v->initial_allocation = initialAllocation;
-    v->elems = malloc(v->alloc_len * elemSize);
+    v->growth_factor = DEFAULT_GROWTH_FACTOR;
     v->free_fn = freeFn;
-    assert(v->elems != NULL);
+    Reallocate(v, (initialAllocation == 0) ? DEFAULT_ALLOC_LEN : initialAllocation);
+}
+
+void VectorSetGrowthFactor(vector *v, double growthFactor)
+{
+    assert(growthFactor > 1.0);
+    v->growth_factor = growthFactor;
+}
+
+void VectorReserve(vector *v, int minAllocation)
+{
+    assert(minAllocation >= 0);
+    if (minAllocation > v->alloc_len) Reallocate(v, minAllocation);
+}
+
+void VectorShrinkToFit(vector *v)
+{
+    if (v->alloc_len > v->log_len) Reallocate(v, v->log_len);
 }
 
 void VectorDispose(vector *v)
 {
     if (v->free_fn != NULL) {
         for (int i = 0; i < v->log_len; i++) {
-            void *tmp = (char *)v->elems + i * v->elem_size;
+            void *tmp = (char *)VectorData(v) + i * v->elem_size;
             v->free_fn(tmp);
         }
     }
-  free(v->elems);
+    if (!IsInline(v)) free(v->storage.elems);
 }
 
 int VectorLength(const vector *v) 
@@ -39,13 +105,13 @@ int VectorLength(const vector *v)
 void *VectorNth(const vector *v, int position) 
 { 
     assert(position >= 0 && position < v->log_len);
-    return (void*)((char*)v->elems + position * v->elem_size); 
+    return (void*)((char*)VectorData(v) + position * v->elem_size); 
 }
 
 void VectorReplace(vector *v, const void *elemAddr, int position)
 {
     assert(position >= 0 && position < v->log_len);
-    void* dest = (char*)v->elems + position * v->elem_size;
+    void* dest = (char*)VectorData(v) + position * v->elem_size;
     if (v->free_fn != NULL) v->free_fn(dest);
     memcpy(dest, elemAddr, v->elem_size);
 }
@@ -53,13 +119,9 @@ void VectorReplace(vector *v, const void *elemAddr, int position)
 void VectorInsert(vector *v, const void *elemAddr, int position)
 {
     assert(position >= 0 && position <= v->log_len);
-    if (v->log_len == v->alloc_len) {
-        v->alloc_len *= 2;
-        v->elems = realloc(v->elems, v->alloc_len * v->elem_size);
-        assert(v->elems != NULL);
-    } 
-    void* from = (char*)v->elems + position * v->elem_size;
-    void* to = (char*)v->elems + (position + 1) * v->elem_size;
+    Grow(v, v->log_len + 1);
+    void* from = (char*)VectorData(v) + position * v->elem_size;
+    void* to = (char*)from + v->elem_size;
     memmove(to, from, (v->log_len - position) * v->elem_size);
     memcpy(from, elemAddr, v->elem_size);
     v->log_len++;
@@ -67,12 +129,8 @@ void VectorInsert(vector *v, const void *elemAddr, int position)
 
 void VectorAppend(vector *v, const void *elemAddr)
 {
-    if (v->log_len == v->alloc_len) {
-        v->alloc_len *= 2;
-        v->elems = realloc(v->elems, v->alloc_len * v->elem_size);
-        assert(v->elems != NULL);
-    } 
-    void* dest = (char*)v->elems + v->log_len * v->elem_size;
+    Grow(v, v->log_len + 1);
+    void* dest = (char*)VectorData(v) + v->log_len * v->elem_size;
     memcpy(dest, elemAddr, v->elem_size);
     v->log_len++;
 }
@@ -80,33 +138,475 @@ void VectorAppend(vector *v, const void *elemAddr)
 void VectorDelete(vector *v, int position)
 {
     assert(position >= 0 && position < v->log_len);
-    void* to = (char*)v->elems + position * v->elem_size;
-    void* from = (char*)v->elems + (position + 1) * v->elem_size;
+    void* to = (char*)VectorData(v) + position * v->elem_size;
+    void* from = (char*)to + v->elem_size;
     if (v->free_fn != NULL) v->free_fn(to);
     memmove(to, from, (v->log_len - position - 1) * v->elem_size);
     v->log_len--;
 }
 
+void VectorAppendN(vector *v, const void *elemsAddr, int n)
+{
+    VectorInsertRange(v, elemsAddr, n, v->log_len);
+}
+
+void VectorInsertRange(vector *v, const void *elemsAddr, int n, int position)
+{
+    assert(position >= 0 && position <= v->log_len);
+    assert(n >= 0);
+    if (n == 0) return;
+    assert(elemsAddr != NULL);
+    Grow(v, v->log_len + n);
+    void* from = (char*)VectorData(v) + position * v->elem_size;
+    void* to = (char*)from + n * v->elem_size;
+    memmove(to, from, (v->log_len - position) * v->elem_size);
+    memcpy(from, elemsAddr, n * v->elem_size);
+    v->log_len += n;
+}
+
+void VectorDeleteRange(vector *v, int position, int n)
+{
+    assert(n >= 0);
+    assert(position >= 0 && position + n <= v->log_len);
+    void* to = (char*)VectorData(v) + position * v->elem_size;
+    void* from = (char*)to + n * v->elem_size;
+    if (v->free_fn != NULL) {
+        for (int i = 0; i < n; i++) v->free_fn((char*)to + i * v->elem_size);
+    }
+    memmove(to, from, (v->log_len - position - n) * v->elem_size);
+    v->log_len -= n;
+}
+
+int VectorRemoveIf(vector *v, VectorPredicateFunction predicateFn, void *auxData)
+{
+    assert(predicateFn != NULL);
+    char* elems = VectorData(v);
+    int kept = 0;
+    for (int i = 0; i < v->log_len; i++) {
+        void* elem = elems + i * v->elem_size;
+        if (predicateFn(elem, auxData)) {
+            if (v->free_fn != NULL) v->free_fn(elem);
+        } else {
+            if (kept != i) memcpy(elems + kept * v->elem_size, elem, v->elem_size);
+            kept++;
+        }
+    }
+    int removed = v->log_len - kept;
+    v->log_len = kept;
+    return removed;
+}
+
+/*
+ * VectorSort is an introsort with two of pdqsort's refinements.  Each
+ * round partitions around the median of three elements (the median of
+ * three medians, for longer stretches) with a Hoare partition, which
+ * splits runs of equal elements evenly.  Stretches of up to
+ * kInsertionSortThreshold elements are finished with an insertion sort,
+ * and quicksort hands over to heapsort once it has recursed twice log2(n)
+ * deep, so no input takes more than O(n log n).  A partition that
+ * didn't have to move any elements suggests the input is already (mostly)
+ * sorted, so each side gets an insertion sort that gives up after
+ * kPartialInsertionSortLimit moves, which sorts such input in linear time.
+ */
+
+#define kInsertionSortThreshold 16
+#define kNintherThreshold 128
+#define kPartialInsertionSortLimit 8
+
+/*
+ * Elements are moved with memcpys whose sizes the compiler can see for
+ * the common sizes of 4, 8 and 16 bytes (ints, longs and pointers, and
+ * pairs of them), so those compile down to a load and a store or two
+ * rather than calls into memcpy.
+ */
+
+static inline void CopyElem(char *dest, const char *src, int size)
+{
+    switch (size) {
+        case 4: memcpy(dest, src, 4); break;
+        case 8: memcpy(dest, src, 8); break;
+        case 16: memcpy(dest, src, 16); break;
+        default: memcpy(dest, src, size); break;
+    }
+}
+
+static inline void SwapElems(char *a, char *b, int size)
+{
+    switch (size) {
+        case 4: { uint32_t tmp; memcpy(&tmp, a, 4); memcpy(a, b, 4); memcpy(b, &tmp, 4); return; }
+        case 8: { uint64_t tmp; memcpy(&tmp, a, 8); memcpy(a, b, 8); memcpy(b, &tmp, 8); return; }
+        case 16: { char tmp[16]; memcpy(tmp, a, 16); memcpy(a, b, 16); memcpy(b, tmp, 16); return; }
+    }
+    for (; size >= (int)sizeof(long); size -= sizeof(long), a += sizeof(long), b += sizeof(long)) {
+        long tmp;
+        memcpy(&tmp, a, sizeof(long));
+        memcpy(a, b, sizeof(long));
+        memcpy(b, &tmp, sizeof(long));
+    }
+    for (; size > 0; size--, a++, b++) {
+        char tmp = *a;
+        *a = *b;
+        *b = tmp;
+    }
+}
+
+/*
+ * The insertion sorts copy the element being inserted out to tmp (room
+ * for one element), shift the larger elements before it up by one, and
+ * copy it back into the gap, rather than swapping it down step by step.
+ */
+
+static void InsertionSort(char *base, int n, int size, VectorCompareFunction compare, char *tmp)
+{
+    for (int i = 1; i < n; i++) {
+        char *p = base + i * size;
+        if (compare(p - size, p) <= 0) continue;
+        CopyElem(tmp, p, size);
+        do {
+            CopyElem(p, p - size, size);
+            p -= size;
+        } while (p > base && compare(p - size, tmp) > 0);
+        CopyElem(p, tmp, size);
+    }
+}
+
+static bool PartialInsertionSort(char *base, int n, int size, VectorCompareFunction compare, char *tmp)
+{
+    int moves = 0;
+    for (int i = 1; i < n; i++) {
+        char *p = base + i * size;
+        if (compare(p - size, p) <= 0) continue;
+        CopyElem(tmp, p, size);
+        do {
+            CopyElem(p, p - size, size);
+            p -= size;
+            moves++;
+        } while (p > base && compare(p - size, tmp) > 0);
+        CopyElem(p, tmp, size);
+        if (moves > kPartialInsertionSortLimit) return false;
+    }
+    return true;
+}
+
+static void SiftDown(char *base, int root, int n, int size, VectorCompareFunction compare)
+{
+    for (int child; (child = 2 * root + 1) < n; root = child) {
+        if (child + 1 < n && compare(base + child * size, base + (child + 1) * size) < 0) child++;
+        if (compare(base + root * size, base + child * size) >= 0) return;
+        SwapElems(base + root * size, base + child * size, size);
+    }
+}
+
+static void HeapSort(char *base, int n, int size, VectorCompareFunction compare)
+{
+    for (int i = n / 2 - 1; i >= 0; i--) SiftDown(base, i, n, size, compare);
+    for (int i = n - 1; i > 0; i--) {
+        SwapElems(base, base + i * size, size);
+        SiftDown(base, 0, i, size, compare);
+    }
+}
+
+static void Sort3(char *a, char *b, char *c, int size, VectorCompareFunction compare)
+{
+    if (compare(b, a) < 0) SwapElems(a, b, size);
+    if (compare(c, b) < 0) {
+        SwapElems(b, c, size);
+        if (compare(b, a) < 0) SwapElems(a, b, size);
+    }
+}
+
+/*
+ * Moves the pivot to the front, leaving an element no smaller than it
+ * somewhere further along, so the partition's forward scan needs no
+ * bounds check.
+ */
+
+static void MovePivotToFront(char *base, int n, int size, VectorCompareFunction compare)
+{
+    char *mid = base + (n / 2) * size, *last = base + (n - 1) * size;
+    Sort3(base, mid, last, size, compare);
+    if (n > kNintherThreshold) {
+        Sort3(base + size, mid - size, last - size, size, compare);
+        Sort3(base + 2 * size, mid + size, last - 2 * size, size, compare);
+        Sort3(mid - size, mid, mid + size, size, compare);
+    }
+    SwapElems(base, mid, size);
+}
+
+static void IntroSort(char *base, int n, int size, VectorCompareFunction compare, int depthLimit, char *tmp)
+{
+    while (n > kInsertionSortThreshold) {
+        if (depthLimit-- == 0) {
+            HeapSort(base, n, size, compare);
+            return;
+        }
+        MovePivotToFront(base, n, size, compare);
+        int i = 1, j = n - 1;
+        bool moved = false;
+        for (;;) {
+            while (compare(base + i * size, base) < 0) i++;
+            while (compare(base + j * size, base) > 0) j--;
+            if (i >= j) break;
+            SwapElems(base + i * size, base + j * size, size);
+            moved = true;
+            i++;
+            j--;
+        }
+        SwapElems(base, base + j * size, size);
+
+        char *right = base + (j + 1) * size;
+        int numRight = n - j - 1;
+        if (!moved && PartialInsertionSort(base, j, size, compare, tmp) &&
+            PartialInsertionSort(right, numRight, size, compare, tmp)) return;
+        if (j < numRight) {         // recur on the smaller side, loop on the larger
+            IntroSort(base, j, size, compare, depthLimit, tmp);
+            base = right;
+            n = numRight;
+        } else {
+            IntroSort(right, numRight, size, compare, depthLimit, tmp);
+            n = j;
+        }
+    }
+    InsertionSort(base, n, size, compare, tmp);
+}
+
 void VectorSort(vector *v, VectorCompareFunction compare)
 {
     assert(compare != NULL);
-    qsort(v->elems, v->log_len, v->elem_size, compare);
+    int depthLimit = 0;
+    for (int n = v->log_len; n > 1; n >>= 1) depthLimit += 2;
+    char *tmp = malloc(v->elem_size);
+    assert(tmp != NULL);
+    IntroSort(VectorData(v), v->log_len, v->elem_size, compare, depthLimit, tmp);
+    free(tmp);
+}
+
+/*
+ * VectorSortStable is a top-down merge sort that insertion sorts
+ * stretches of up to kInsertionSortThreshold elements, skips merges
+ * whose halves are already in order, and merges by copying the left half
+ * out to a scratch buffer of n / 2 elements.  On ties the left half
+ * wins, which is what keeps it stable.  VectorSortParallel sorts the
+ * halves on separate threads, recursively, until it runs out of threads
+ * or the halves drop below kParallelSortThreshold elements.  Its scratch
+ * buffer holds n elements, and each half works in the part of it at the
+ * same offset as its own elements, so concurrent sorts and merges never
+ * share scratch space.
+ */
+
+#define kParallelSortThreshold 32768
+
+static void Merge(char *base, int numLeft, int n, int size, VectorCompareFunction compare, char *scratch)
+{
+    char *right = base + numLeft * size, *end = base + n * size;
+    if (compare(right - size, right) <= 0) return;
+    memcpy(scratch, base, numLeft * size);
+    char *left = scratch, *leftEnd = scratch + numLeft * size, *dest = base;
+    while (left < leftEnd && right < end) {
+        if (compare(right, left) < 0) {
+            memcpy(dest, right, size);
+            right += size;
+        } else {
+            memcpy(dest, left, size);
+            left += size;
+        }
+        dest += size;
+    }
+    memcpy(dest, left, leftEnd - left);
+}
+
+static void MergeSort(char *base, int n, int size, VectorCompareFunction compare, char *scratch)
+{
+    if (n <= kInsertionSortThreshold) {
+        InsertionSort(base, n, size, compare, scratch);    // scratch is free until the merges
+        return;
+    }
+    int numLeft = n / 2;
+    MergeSort(base, numLeft, size, compare, scratch);
+    MergeSort(base + numLeft * size, n - numLeft, size, compare, scratch);
+    Merge(base, numLeft, n, size, compare, scratch);
+}
+
+void VectorSortStable(vector *v, VectorCompareFunction compare)
+{
+    assert(compare != NULL);
+    if (v->log_len <= 1) return;
+    char *scratch = malloc((size_t)(v->log_len / 2 + 1) * v->elem_size);
+    assert(scratch != NULL);
+    MergeSort(VectorData(v), v->log_len, v->elem_size, compare, scratch);
+    free(scratch);
+}
+
+typedef struct {
+    char *base;
+    int n;
+    int size;
+    VectorCompareFunction compare;
+    char *scratch;
+    int numThreads;
+} sortjob;
+
+static void *ParallelMergeSort(void *data)
+{
+    sortjob *job = data;
+    if (job->numThreads <= 1 || job->n < 2 * kParallelSortThreshold) {
+        MergeSort(job->base, job->n, job->size, job->compare, job->scratch);
+        return NULL;
+    }
+    int numLeft = job->n / 2;
+    sortjob left = { job->base, numLeft, job->size, job->compare, job->scratch, job->numThreads / 2 };
+    sortjob right = { job->base + numLeft * job->size, job->n - numLeft, job->size, job->compare,
+                      job->scratch + numLeft * job->size, job->numThreads - job->numThreads / 2 };
+    pthread_t thread;
+    bool spawned = pthread_create(&thread, NULL, ParallelMergeSort, &left) == 0;
+    if (!spawned) ParallelMergeSort(&left);
+    ParallelMergeSort(&right);
+    if (spawned) pthread_join(thread, NULL);
+    Merge(job->base, numLeft, job->n, job->size, job->compare, job->scratch);
+    return NULL;
+}
+
+void VectorSortParallel(vector *v, VectorCompareFunction compare, int numThreads)
+{
+    assert(compare != NULL);
+    assert(numThreads > 0);
+    if (v->log_len <= 1) return;
+    char *scratch = malloc((size_t)v->log_len * v->elem_size);
+    assert(scratch != NULL);
+    sortjob job = { VectorData(v), v->log_len, v->elem_size, compare, scratch, numThreads };
+    ParallelMergeSort(&job);
+    free(scratch);
+}
+
+/*
+ * VectorRadixSort computes every element's key once, and sorts (key,
+ * position) pairs with a least-significant-digit radix sort, a byte at a
+ * time.  All four byte histograms are counted in a single pass up front,
+ * and a pass whose byte is the same for every key is skipped altogether,
+ * so small keys cost only as many passes as they have significant bytes.
+ * The elements themselves are moved just once, at the end.
+ */
+
+typedef struct {
+    unsigned int key;
+    int position;
+} keyedposition;
+
+void VectorRadixSort(vector *v, VectorKeyFunction keyfn)
+{
+    assert(keyfn != NULL);
+    int n = v->log_len, size = v->elem_size;
+    if (n <= 1) return;
+    char *elems = VectorData(v);
+    keyedposition *keys = malloc(n * sizeof(keyedposition));
+    keyedposition *sorted = malloc(n * sizeof(keyedposition));
+    assert(keys != NULL && sorted != NULL);
+
+    int counts[4][256];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < n; i++) {
+        unsigned int key = keyfn(elems + i * size);
+        keys[i].key = key;
+        keys[i].position = i;
+        for (int byte = 0; byte < 4; byte++) counts[byte][(key >> (8 * byte)) & 0xff]++;
+    }
+
+    for (int byte = 0; byte < 4; byte++) {
+        int shift = 8 * byte;
+        if (counts[byte][(keys[0].key >> shift) & 0xff] == n) continue;
+        int offsets[256];
+        for (int digit = 0, total = 0; digit < 256; digit++) {
+            offsets[digit] = total;
+            total += counts[byte][digit];
+        }
+        for (int i = 0; i < n; i++) sorted[offsets[(keys[i].key >> shift) & 0xff]++] = keys[i];
+        keyedposition *tmp = keys;
+        keys = sorted;
+        sorted = tmp;
+    }
+
+    char *permuted = malloc((size_t)n * size);
+    assert(permuted != NULL);
+    for (int i = 0; i < n; i++) memcpy(permuted + i * size, elems + keys[i].position * size, size);
+    memcpy(elems, permuted, (size_t)n * size);
+    free(permuted);
+    free(keys);
+    free(sorted);
 }
 
 void VectorMap(vector *v, VectorMapFunction mapFn, void *auxData)
 {
     assert(mapFn != NULL);
     for (int i = 0; i < v->log_len; i++) {
-        mapFn((char*)v->elems + v->elem_size * i, auxData);
+        mapFn((char*)VectorData(v) + v->elem_size * i, auxData);
     }
 }
 
+/*
+ * VectorMapParallel and VectorMapReduce split the vector into
+ * ThreadPoolNumTasks ranges, and each task works through one of them.
+ * VectorMapReduce gives every task its own partial result, side by side
+ * in one buffer, each starting kCacheLineSize bytes past the last so that
+ * tasks on different threads don't fight over the same cache line.
+ */
+
+#define kCacheLineSize 64
+
+typedef struct {
+    vector *v;
+    VectorMapFunction mapfn;
+    VectorAccumulateFunction accumulatefn;
+    void *aux_data;
+    int num_tasks;
+    char *partials;
+    int partial_size;
+} maptask;
+
+static void MapRange(int task, void *data)
+{
+    maptask *m = data;
+    int start, end;
+    ThreadPoolTaskRange(task, m->num_tasks, m->v->log_len, &start, &end);
+    char *elems = VectorData(m->v);
+    int size = m->v->elem_size;
+    if (m->mapfn != NULL) {
+        for (int i = start; i < end; i++) m->mapfn(elems + i * size, m->aux_data);
+    } else {
+        void *partial = m->partials + task * m->partial_size;
+        for (int i = start; i < end; i++) m->accumulatefn(elems + i * size, partial, m->aux_data);
+    }
+}
+
+void VectorMapParallel(vector *v, VectorMapFunction mapFn, void *auxData, threadpool *pool)
+{
+    assert(mapFn != NULL);
+    assert(pool != NULL);
+    maptask m = { v, mapFn, NULL, auxData, ThreadPoolNumTasks(pool, v->log_len), NULL, 0 };
+    ThreadPoolRun(pool, m.num_tasks, MapRange, &m);
+}
+
+void VectorMapReduce(vector *v, VectorAccumulateFunction accumulateFn, VectorCombineFunction combineFn,
+                     void *resultAddr, int resultSize, void *auxData, threadpool *pool)
+{
+    assert(accumulateFn != NULL && combineFn != NULL);
+    assert(resultAddr != NULL && resultSize > 0);
+    assert(pool != NULL);
+    int stride = (resultSize + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+    maptask m = { v, NULL, accumulateFn, auxData, ThreadPoolNumTasks(pool, v->log_len), NULL, stride };
+    m.partials = malloc((size_t)m.num_tasks * stride);
+    assert(m.partials != NULL);
+    for (int i = 0; i < m.num_tasks; i++) memcpy(m.partials + i * stride, resultAddr, resultSize);
+    ThreadPoolRun(pool, m.num_tasks, MapRange, &m);
+    for (int i = 0; i < m.num_tasks; i++) combineFn(resultAddr, m.partials + i * stride, auxData);
+    free(m.partials);
+}
+
 static const int kNotFound = -1;
 int VectorSearch(const vector *v, const void *key, VectorCompareFunction searchFn, int startIndex, bool isSorted)
 { 
     assert(searchFn != NULL);
     assert(startIndex >= 0 && startIndex <= v->log_len);
-    void* base = (char*)v->elems + startIndex * v->elem_size;
+    void* base = (char*)VectorData(v) + startIndex * v->elem_size;
     void* res;
     if(isSorted) {
         res = bsearch(key, base, v->log_len - startIndex, v->elem_size, searchFn);
@@ -114,5 +614,5 @@ int VectorSearch(const vector *v, const void *key, VectorCompareFunction searchF
         size_t size = v->log_len - startIndex;
         res = lfind(key, base, &size, v->elem_size, searchFn);
     }
-    return res == NULL ? kNotFound : (int)((char*)res - (char*)v->elems) / v->elem_size; 
+    return res == NULL ? kNotFound : (int)((char*)res - (char*)VectorData(v)) / v->elem_size; 
 } 
@@ -17,6 +17,8 @@
 #define _vector_
 
 #include "bool.h"
+#include "threadpool.h"
+#include <stddef.h>
 
 /**
  * Type: VectorCompareFunction
@@ -45,6 +47,44 @@ typedef int (*VectorCompareFunction)(const void *elemAddr1, const void *elemAddr
 
 typedef void (*VectorMapFunction)(void *elemAddr, void *auxData);
 
+/**
+ * Type: VectorKeyFunction
+ * -----------------------
+ * VectorKeyFunction is a pointer to a client-supplied function which
+ * VectorRadixSort uses to sort elements by an unsigned integer key.  It
+ * takes a pointer to an element and returns the element's key.  Keys are
+ * sorted in ascending order, so a function that sorts by an int x
+ * should return (unsigned int)x ^ 0x80000000, and one that sorts in
+ * descending order should return the complement (~) of the ascending key.
+ */
+
+typedef unsigned int (*VectorKeyFunction)(const void *elemAddr);
+
+/**
+ * Type: VectorPredicateFunction
+ * -----------------------------
+ * VectorPredicateFunction defines the space of functions that can be used
+ * to pick out elements for VectorRemoveIf.  A predicate is called with
+ * a pointer to the element and a client data pointer passed in from the
+ * original caller, and returns true for the elements it picks.
+ */
+
+typedef bool (*VectorPredicateFunction)(const void *elemAddr, void *auxData);
+
+/**
+ * Types: VectorAccumulateFunction, VectorCombineFunction
+ * ------------------------------------------------------
+ * The two halves of a reduction run by VectorMapReduce.  An accumulate
+ * function folds the element at elemAddr into the partial result at
+ * partialAddr, and a combine function folds one partial result into
+ * another.  A sum of the elements, say, would add each element to the
+ * partial sum in the first, and add one partial sum to another in the
+ * second.  Both are passed the auxData pointer handed to VectorMapReduce.
+ */
+
+typedef void (*VectorAccumulateFunction)(void *elemAddr, void *partialAddr, void *auxData);
+typedef void (*VectorCombineFunction)(void *resultAddr, const void *partialAddr, void *auxData);
+
 /** 
  * Type: VectorFreeFunction
  * ---------------------------------
@@ -56,6 +96,21 @@ typedef void (*VectorMapFunction)(void *elemAddr, void *auxData);
 
 typedef void (*VectorFreeFunction)(void *elemAddr);
 
+/**
+ * Constant: kVectorInlineBytes
+ * ----------------------------
+ * A vector whose allocation comes to no more than kVectorInlineBytes
+ * keeps its elements inside the vector struct itself, in the space that
+ * would otherwise hold the pointer to its heap-allocated elements, so
+ * short vectors cost no allocation at all.  Whether the elements are
+ * inline follows from alloc_len and elem_size alone (nothing in the struct
+ * points back into the struct), so a vector can still be moved around
+ * with memcpy, as hashsets do with their elements.  Inline elements are
+ * aligned as strictly as a pointer or a double.
+ */
+
+#define kVectorInlineBytes 16
+
 /**
  * Type: vector
  * ------------
@@ -68,14 +123,32 @@ typedef void (*VectorFreeFunction)(void *elemAddr);
  */
 
 typedef struct {
-  void* elems;
-  int initial_allocation;
+  union {
+    void* elems;
+    char inline_elems[kVectorInlineBytes];
+    double align_double;
+  } storage;
+  float growth_factor;
   int alloc_len;
   int log_len;
   int elem_size;
   VectorFreeFunction free_fn;
 } vector;
 
+/**
+ * Function: VectorData
+ * --------------------
+ * Returns the address of element 0, wherever the elements currently
+ * live.  Element n is elem_size * n bytes further along.  Like the
+ * pointers VectorNth returns, the address is only good until the
+ * next call that adds elements or changes the allocation.
+ */
+
+static inline void *VectorData(const vector *v)
+{
+  return ((size_t)v->alloc_len * v->elem_size <= kVectorInlineBytes) ? (void *)v->storage.inline_elems : v->storage.elems;
+}
+
 /** 
  * Function: VectorNew
  * Usage: vector myFriends;
@@ -97,23 +170,17 @@ typedef struct {
  * NULL for the ArrayFreeFunction if the elements don't require any special handling.
  *
  * The initialAllocation parameter specifies the initial allocated length 
- * of the vector, as well as the dynamic reallocation increment for those times when the 
- * vector needs to grow.  Rather than growing the vector one element at a time as 
- * elements are added (inefficient), you will grow the vector 
- * in chunks of initialAllocation size.  The allocated length is the number
+ * of the vector.  The allocated length is the number
  * of elements for which space has been allocated: the logical length 
  * is the number of those slots currently being used.
  * 
- * A new vector pre-allocates space for initialAllocation elements, but the
+ * A new vector pre-allocates space for initialAllocation elements (or for
+ * as many as fit in kVectorInlineBytes, if that's more and they do), but the
  * logical length is zero.  As elements are added, those allocated slots fill
- * up, and when the initial allocation is all used, grow the vector by another 
- * initialAllocation elements.  You will continue growing the vector in chunks
- * like this as needed.  Thus the allocated length will always be a multiple
- * of initialAllocation.  Don't worry about using realloc to shrink the vector's 
- * allocation if a bunch of elements get deleted.  It turns out that 
- * many implementations of realloc don't even pay attention to such a request, 
- * so there is little point in asking.  Just leave the vector over-allocated and no
- * one will care.
+ * up, and when they're all used, the allocated length is multiplied by the
+ * vector's growth factor, which is 2 unless VectorSetGrowthFactor says
+ * otherwise.  Deleting elements never shrinks the allocation by itself;
+ * call VectorShrinkToFit once a vector is done changing size.
  *
  * The initialAllocation is the client's opportunity to tune the resizing
  * behavior for his/her particular needs.  Clients who expect their vectors to
@@ -128,6 +195,39 @@ typedef struct {
 
 void VectorNew(vector *v, int elemSize, VectorFreeFunction freefn, int initialAllocation);
 
+/**
+ * Function: VectorSetGrowthFactor
+ * -------------------------------
+ * Sets the factor the allocated length is multiplied by whenever the
+ * vector runs out of room.  Smaller factors waste less memory on slack at
+ * the end of the vector, at the price of reallocating (and copying) more
+ * often.  An assert is raised unless growthFactor is greater than 1.
+ */
+
+void VectorSetGrowthFactor(vector *v, double growthFactor);
+
+/**
+ * Function: VectorReserve
+ * -----------------------
+ * Makes sure the vector has room for at least minAllocation elements, so
+ * that it can grow to that length without any further reallocation.
+ * Never reduces the allocation.  An assert is raised if minAllocation is
+ * negative.
+ */
+
+void VectorReserve(vector *v, int minAllocation);
+
+/**
+ * Function: VectorShrinkToFit
+ * ---------------------------
+ * Reduces the allocated length to the logical length, moving the elements
+ * back inside the vector struct if they now fit there.  Pointers returned by
+ * VectorNth become invalid.  Appending afterwards grows the vector again
+ * as usual.
+ */
+
+void VectorShrinkToFit(vector *v);
+
 /**
  * Function: VectorDispose
  *           VectorDispose(&studentsDroppingTheCourse);
@@ -219,10 +319,62 @@ void VectorReplace(vector *v, const void *elemAddr, int position);
  * minus one.  All the elements after the specified position will be shifted over to fill 
  * the gap.  This method runs in linear time.  It does not shrink the 
  * allocated size of the vector when an element is deleted; the vector just 
- * stays over-allocated.
+ * stays over-allocated until VectorShrinkToFit is called.
  */
 
 void VectorDelete(vector *v, int position);
+
+/**
+ * Function: VectorAppendN
+ * -----------------------
+ * Appends n new elements to the end of the specified vector, copying their
+ * contents from the n consecutive elements starting at elemsAddr.  The
+ * elements end up just as if each had been passed to VectorAppend in turn,
+ * but the vector grows (if it needs to) at most once.  elemsAddr may not
+ * point into the vector itself.  An assert is raised if n is negative, or
+ * if elemsAddr is NULL when n is positive.
+ */
+
+void VectorAppendN(vector *v, const void *elemsAddr, int n);
+
+/**
+ * Function: VectorInsertRange
+ * ---------------------------
+ * Inserts n new elements into the specified vector, copied from the n
+ * consecutive elements starting at elemsAddr, so that the first of them
+ * ends up at the specified position and the rest follow in order.  The
+ * elements after them are shifted over once, by n positions, rather than
+ * once per element inserted.  elemsAddr may not point into the vector
+ * itself.  Asserts are raised just as by VectorInsert and VectorAppendN.
+ * This method runs in linear time.
+ */
+
+void VectorInsertRange(vector *v, const void *elemsAddr, int n, int position);
+
+/**
+ * Function: VectorDeleteRange
+ * ---------------------------
+ * Deletes the n elements starting at the specified position, calling the
+ * VectorFreeFunction on each of them first, and shifts the elements after
+ * them over to fill the gap all at once.  An assert is raised if n is
+ * negative, or if the range runs outside the vector.  Like VectorDelete,
+ * it never shrinks the allocation.  This method runs in linear time.
+ */
+
+void VectorDeleteRange(vector *v, int position, int n);
+
+/**
+ * Function: VectorRemoveIf
+ * ------------------------
+ * Deletes every element for which the predicate returns true, calling the
+ * VectorFreeFunction on each, and returns how many were deleted.  The
+ * elements that remain keep their relative order.  Each is moved at most
+ * once, so the whole call runs in linear time however many elements go.
+ * The predicate is called exactly once per element, in order.  An assert
+ * is raised if the predicate is NULL.
+ */
+
+int VectorRemoveIf(vector *v, VectorPredicateFunction predicatefn, void *auxData);
   
 /* 
  * Function: VectorSearch
@@ -253,11 +405,52 @@ int VectorSearch(const vector *v, const void *key, VectorCompareFunction searchf
  * --------------------
  * Sorts the vector into ascending order according to the supplied
  * comparator.  The numbering of the elements will change to reflect the 
- * new ordering.  An assert is raised if the comparator is NULL.
+ * new ordering.  An assert is raised if the comparator is NULL.  The
+ * sort takes O(n log n) time in the worst case and close to linear time
+ * on input that's already sorted, but elements the comparator considers
+ * equal may end up in any order.  (Vectors made by DEFINE_TYPED_VECTOR
+ * can be sorted with the comparator inlined by DEFINE_TYPED_VECTOR_SORT.)
  */
 
 void VectorSort(vector *v, VectorCompareFunction comparefn);
 
+/**
+ * Function: VectorSortStable
+ * --------------------------
+ * Sorts the vector just as VectorSort does, except that elements the
+ * comparator considers equal keep their relative order.  Needs temporary
+ * space for half the elements.
+ */
+
+void VectorSortStable(vector *v, VectorCompareFunction comparefn);
+
+/**
+ * Function: VectorSortParallel
+ * ----------------------------
+ * Sorts the vector exactly as VectorSortStable does, spreading the work
+ * over as many as numThreads threads (the calling thread among them).
+ * Threads are only brought in for vectors long enough to be worth it,
+ * so for short vectors this is no different from VectorSortStable.  The
+ * comparator may be called from several threads at once.  Needs temporary
+ * space for all the elements.  An assert is raised if the comparator is
+ * NULL or numThreads is less than 1.
+ */
+
+void VectorSortParallel(vector *v, VectorCompareFunction comparefn, int numThreads);
+
+/**
+ * Function: VectorRadixSort
+ * -------------------------
+ * Sorts the vector into ascending order of the keys keyfn returns,
+ * calling keyfn exactly once per element.  Elements with equal keys keep
+ * their relative order.  Runs in linear time, making up to four passes
+ * over the keys (fewer when the keys' high bytes are all the same), and
+ * needs temporary space for the elements and for two arrays of keys.  An
+ * assert is raised if keyfn is NULL.
+ */
+
+void VectorRadixSort(vector *v, VectorKeyFunction keyfn);
+
 /**
  * Method: VectorMap
  * -----------------
@@ -271,4 +464,41 @@ void VectorSort(vector *v, VectorCompareFunction comparefn);
 
 void VectorMap(vector *v, VectorMapFunction mapfn, void *auxData);
 
+/**
+ * Function: VectorMapParallel
+ * ---------------------------
+ * Calls mapfn on every element, just as VectorMap does, except that the
+ * vector is split into ranges of neighboring elements which the threads
+ * of the pool work through at the same time.  So the elements are not
+ * visited in order, and mapfn must be thread-safe: it may change the
+ * element it's passed, but anything else it changes (including anything
+ * reachable through auxData) must be protected, and it must not change
+ * the vector itself.  Returns once mapfn has been called on every
+ * element.  An assert is raised if mapfn or pool is NULL.
+ */
+
+void VectorMapParallel(vector *v, VectorMapFunction mapfn, void *auxData, threadpool *pool);
+
+/**
+ * Function: VectorMapReduce
+ * -------------------------
+ * Aggregates the elements in parallel.  The vector is split into ranges
+ * of neighboring elements as by VectorMapParallel, and each range gets a
+ * partial result of resultSize bytes, which starts out as a copy of the
+ * one at resultAddr and has every element of the range folded into it,
+ * in order, by accumulatefn.  The partial results are then folded into
+ * the one at resultAddr by combinefn, in the order of their ranges, on
+ * the calling thread.  So on entry, resultAddr must hold what combinefn
+ * treats as nothing at all (0, for a sum), and combinefn must be
+ * associative for the result not to depend on how the elements were
+ * split up.  accumulatefn is called from many threads at once, each
+ * with partial results of its own, so it needs protection only for
+ * what it changes beyond the partial result and its element.  An assert
+ * is raised if any of the pointers passed is NULL or resultSize is not
+ * positive.
+ */
+
+void VectorMapReduce(vector *v, VectorAccumulateFunction accumulatefn, VectorCombineFunction combinefn,
+                     void *resultAddr, int resultSize, void *auxData, threadpool *pool);
+
 #endif
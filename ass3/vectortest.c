@@ -1,4 +1,5 @@
 #include "vector.h"
+#include "typedvector.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -393,6 +394,338 @@ static void MemoryTest()
   VectorDispose(&questionWords);
 }
 
+/**
+ * Function: CapacityTest
+ * ----------------------
+ * Exercises VectorReserve, VectorShrinkToFit and VectorSetGrowthFactor,
+ * making sure the elements survive every move: from the storage inside
+ * the vector struct out to the heap, around the heap, and back again.
+ * Halfway through, the vector struct itself is copied with memcpy, which
+ * must leave the copy working even while its elements are inline.
+ */
+
+static void CapacityTest()
+{
+  vector numbers, moved;
+  long i;
+
+  fprintf(stdout, "\n\n------------------------- Starting the capacity tests...\n");
+  VectorNew(&numbers, sizeof(long), NULL, 1);
+  VectorSetGrowthFactor(&numbers, 1.5);
+  for (i = 0; i < 1000; i++) VectorAppend(&numbers, &i);
+  assert(numbers.alloc_len >= 1000 && numbers.alloc_len < 1500);
+
+  VectorReserve(&numbers, 5000);
+  assert(numbers.alloc_len == 5000);
+  VectorReserve(&numbers, 10);
+  assert(numbers.alloc_len == 5000);
+  for (i = 0; i < 1000; i++) assert(*(long *)VectorNth(&numbers, i) == i);
+  fprintf(stdout, "Grew to 1000 elements by half again each time, and reserved room for 5000.\n");
+
+  while (VectorLength(&numbers) > 2) VectorDelete(&numbers, VectorLength(&numbers) - 1);
+  VectorShrinkToFit(&numbers);
+  assert(numbers.alloc_len * sizeof(long) <= kVectorInlineBytes);
+  memcpy(&moved, &numbers, sizeof(vector));
+  assert(*(long *)VectorNth(&moved, 0) == 0 && *(long *)VectorNth(&moved, 1) == 1);
+  fprintf(stdout, "Shrunk to 2 elements, which now live inside the vector struct itself.\n");
+
+  for (i = 2; i < 100; i++) VectorAppend(&moved, &i);
+  VectorShrinkToFit(&moved);
+  assert(moved.alloc_len == 100);
+  for (i = 0; i < 100; i++) assert(*(long *)VectorNth(&moved, i) == i);
+  fprintf(stdout, "Grew back out to 100 elements and shrunk to fit them exactly.\n");
+  VectorDispose(&moved);
+}
+
+/**
+ * Function: IsVowel
+ * -----------------
+ * Predicate for VectorRemoveIf that picks out the vowels
+ * in a vector of characters.
+ */
+
+static bool IsVowel(const void *elemAddr, void *unused)
+{
+  return strchr("AEIOUaeiou", *(const char *)elemAddr) != NULL;
+}
+
+/**
+ * Function: RangeTest
+ * -------------------
+ * Exercises the bulk operations on a vector of characters: appends the
+ * alphabet in one go, inserts the digits into the middle of it and at
+ * either end, deletes ranges back out (the empty range included), and
+ * finally strips out the vowels with VectorRemoveIf.
+ */
+
+static void RangeTest()
+{
+  const char *kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  const char *kDigits = "0123456789";
+  vector alphabet;
+
+  fprintf(stdout, "\n\n------------------------- Starting the range tests...\n");
+  VectorNew(&alphabet, sizeof(char), NULL, 4);
+  VectorAppendN(&alphabet, kAlphabet, strlen(kAlphabet));
+  fprintf(stdout, "After appending the alphabet all at once: ");
+  VectorMap(&alphabet, PrintChar, stdout);
+
+  VectorInsertRange(&alphabet, kDigits, 10, 13);
+  VectorInsertRange(&alphabet, kDigits, 3, 0);
+  VectorInsertRange(&alphabet, kDigits + 7, 3, VectorLength(&alphabet));
+  VectorInsertRange(&alphabet, kDigits, 0, 5);
+  fprintf(stdout, "\nAfter inserting digits in the middle and at either end: ");
+  VectorMap(&alphabet, PrintChar, stdout);
+
+  VectorDeleteRange(&alphabet, 16, 10);
+  VectorDeleteRange(&alphabet, 0, 3);
+  VectorDeleteRange(&alphabet, VectorLength(&alphabet) - 3, 3);
+  VectorDeleteRange(&alphabet, 5, 0);
+  assert(VectorLength(&alphabet) == 26);
+  fprintf(stdout, "\nAfter deleting the digits again: ");
+  VectorMap(&alphabet, PrintChar, stdout);
+
+  int removed = VectorRemoveIf(&alphabet, IsVowel, NULL);
+  assert(removed == 5 && VectorLength(&alphabet) == 21);
+  fprintf(stdout, "\nAfter removing all %d vowels: ", removed);
+  VectorMap(&alphabet, PrintChar, stdout);
+  fprintf(stdout, "\n");
+  VectorDispose(&alphabet);
+}
+
+/**
+ * Functions: ComparePairKeys, PairKey
+ * -----------------------------------
+ * Compare and key functions for the pairs SortTest sorts, which look
+ * at the key alone so that the original positions can show whether
+ * the stable sorts kept equal keys in order.
+ */
+
+struct pair {
+  int key;
+  int position;
+};
+
+static int ComparePairKeys(const void *elem1, const void *elem2)
+{
+  return ((const struct pair *)elem1)->key - ((const struct pair *)elem2)->key;
+}
+
+static unsigned int PairKey(const void *elem)
+{
+  return (unsigned int)((const struct pair *)elem)->key ^ 0x80000000;
+}
+
+/**
+ * Function: CheckSorted
+ * ---------------------
+ * Asserts that the pairs are in order of their keys, and, if the sort
+ * that put them there was supposed to be stable, that pairs with equal
+ * keys are still in order of their original positions.
+ */
+
+static void CheckSorted(const vector *pairs, int n, bool stable)
+{
+  assert(VectorLength(pairs) == n);
+  for (int i = 1; i < n; i++) {
+    const struct pair *prev = VectorNth(pairs, i - 1), *curr = VectorNth(pairs, i);
+    assert(prev->key <= curr->key);
+    assert(!stable || prev->key < curr->key || prev->position < curr->position);
+  }
+}
+
+typedef void (*SortFunction)(vector *pairs);
+
+static void IntroSort(vector *pairs) { VectorSort(pairs, ComparePairKeys); }
+static void StableSort(vector *pairs) { VectorSortStable(pairs, ComparePairKeys); }
+static void ParallelSort(vector *pairs) { VectorSortParallel(pairs, ComparePairKeys, 4); }
+static void RadixSort(vector *pairs) { VectorRadixSort(pairs, PairKey); }
+
+/**
+ * Function: SortTest
+ * ------------------
+ * Runs every sort over pairs whose keys come in several shapes:
+ * random with lots of duplicates, random and negative as well as
+ * positive, already sorted, reversed, and all the same.  The vectors
+ * are long enough for VectorSortParallel to actually use its threads
+ * and for VectorSort's quicksort to recur many levels deep.
+ */
+
+static void SortTest()
+{
+  const char *kSortNames[] = {"VectorSort", "VectorSortStable", "VectorSortParallel", "VectorRadixSort"};
+  const SortFunction kSorts[] = {IntroSort, StableSort, ParallelSort, RadixSort};
+  const bool kStable[] = {false, true, true, true};
+  const int n = 200000;
+
+  fprintf(stdout, "\n\n------------------------- Starting the sorting tests...\n");
+  srand(107);
+  for (int sort = 0; sort < 4; sort++) {
+    for (int shape = 0; shape < 5; shape++) {
+      vector pairs;
+      VectorNew(&pairs, sizeof(struct pair), NULL, 0);
+      for (int i = 0; i < n; i++) {
+        struct pair pair = { 0, i };
+        switch (shape) {
+          case 0: pair.key = rand() % 1000; break;
+          case 1: pair.key = rand() - RAND_MAX / 2; break;
+          case 2: pair.key = i; break;
+          case 3: pair.key = n - i; break;
+          case 4: pair.key = 7; break;
+        }
+        VectorAppend(&pairs, &pair);
+      }
+      kSorts[sort](&pairs);
+      CheckSorted(&pairs, n, kStable[sort]);
+      VectorDispose(&pairs);
+    }
+    fprintf(stdout, "%s sorted random, sorted, reversed and constant keys%s.\n",
+            kSortNames[sort], kStable[sort] ? ", keeping equal keys in order" : "");
+  }
+}
+
+/**
+ * Functions: LongLess, PairLess
+ * -----------------------------
+ * Less functions for the typed sorts TypedTest runs, ordering longs by
+ * value and pairs by key alone, just as LongCompare and ComparePairKeys
+ * order them for VectorSort.
+ */
+
+static inline bool LongLess(const long *elem1, const long *elem2)
+{
+  return *elem1 < *elem2;
+}
+
+static inline bool PairLess(const struct pair *elem1, const struct pair *elem2)
+{
+  return elem1->key < elem2->key;
+}
+
+DEFINE_TYPED_VECTOR(longvector, long)
+DEFINE_TYPED_VECTOR_SORT(longvector, LongLess)
+DEFINE_TYPED_VECTOR(pairvector, struct pair)
+DEFINE_TYPED_VECTOR_SORT(pairvector, PairLess)
+
+/**
+ * Function: TypedTest
+ * -------------------
+ * Builds the same vectors through the typed flavors of typedvector.h
+ * and through the generic functions, and checks that appending,
+ * replacing and sorting leave both holding the very same elements.
+ * Neither sort is stable, so pairs are compared by key alone once
+ * they're sorted.
+ */
+
+static void TypedTest()
+{
+  const int n = 100000;
+  longvector typedLongs;
+  pairvector typedPairs;
+  vector longs, pairs;
+
+  fprintf(stdout, "\n\n------------------------- Starting the typed vector tests...\n");
+  srand(211);
+  longvectorNew(&typedLongs, NULL, 0);
+  pairvectorNew(&typedPairs, NULL, 4);
+  VectorNew(&longs, sizeof(long), NULL, 0);
+  VectorNew(&pairs, sizeof(struct pair), NULL, 4);
+  for (int shape = 0; shape < 4; shape++) {
+    for (int i = 0; i < n; i++) {
+      long number;
+      switch (shape) {
+        case 0: number = rand() % 2000000 - 1000000; break;
+        case 1: number = rand() % 100; break;
+        case 2: number = i; break;
+        default: number = n - i; break;
+      }
+      struct pair pair = { (int)number, i };
+      longvectorAppend(&typedLongs, number);
+      pairvectorAppend(&typedPairs, pair);
+      VectorAppend(&longs, &number);
+      VectorAppend(&pairs, &pair);
+    }
+    for (int i = 0; i < n; i += 97) {
+      long number = -i;
+      longvectorReplace(&typedLongs, number, i);
+      VectorReplace(&longs, &number, i);
+    }
+
+    longvectorSort(&typedLongs);
+    pairvectorSort(&typedPairs);
+    VectorSort(&longs, LongCompare);
+    VectorSort(&pairs, ComparePairKeys);
+    assert(longvectorLength(&typedLongs) == n && pairvectorLength(&typedPairs) == n);
+    for (int i = 0; i < n; i++) {
+      assert(*longvectorNth(&typedLongs, i) == *(long *)VectorNth(&longs, i));
+      assert(pairvectorNth(&typedPairs, i)->key == ((struct pair *)VectorNth(&pairs, i))->key);
+    }
+    VectorDeleteRange(&typedLongs.v, 0, n);
+    VectorDeleteRange(&typedPairs.v, 0, n);
+    VectorDeleteRange(&longs, 0, n);
+    VectorDeleteRange(&pairs, 0, n);
+  }
+  fprintf(stdout, "Typed and generic vectors of longs and pairs sorted alike.\n");
+  longvectorDispose(&typedLongs);
+  pairvectorDispose(&typedPairs);
+  VectorDispose(&longs);
+  VectorDispose(&pairs);
+}
+
+/**
+ * Functions: SquareLong, AddLong, AddSums
+ * ---------------------------------------
+ * Helpers for ParallelMapTest.  SquareLong squares a long in place,
+ * and AddLong and AddSums total up a vector of longs as the accumulate
+ * and combine halves of VectorMapReduce.
+ */
+
+static void SquareLong(void *elem, void *unused)
+{
+  *(long *)elem *= *(long *)elem;
+}
+
+static void AddLong(void *elem, void *partial, void *unused)
+{
+  *(long *)partial += *(long *)elem;
+}
+
+static void AddSums(void *result, const void *partial, void *unused)
+{
+  *(long *)result += *(const long *)partial;
+}
+
+/**
+ * Function: ParallelMapTest
+ * -------------------------
+ * Squares the numbers from 0 to n - 1 in place on a pool of threads,
+ * then has the same pool sum up the squares, and checks every square
+ * and the sum against the formulas.  Also maps over an empty vector,
+ * which shouldn't call anything.
+ */
+
+static void ParallelMapTest()
+{
+  const long n = 100000;
+  vector numbers;
+  threadpool pool;
+  long i, sum = 0;
+
+  fprintf(stdout, "\n\n------------------------- Starting the parallel map tests...\n");
+  ThreadPoolNew(&pool, 4);
+  VectorNew(&numbers, sizeof(long), NULL, n);
+  VectorMapParallel(&numbers, SquareLong, NULL, &pool);
+  for (i = 0; i < n; i++) VectorAppend(&numbers, &i);
+  VectorMapParallel(&numbers, SquareLong, NULL, &pool);
+  for (i = 0; i < n; i++) assert(*(long *)VectorNth(&numbers, i) == i * i);
+  VectorMapReduce(&numbers, AddLong, AddSums, &sum, sizeof(sum), NULL, &pool);
+  assert(sum == (n - 1) * n * (2 * n - 1) / 6);
+  fprintf(stdout, "%d threads squared the numbers below %ld and summed the squares to %ld.\n",
+          ThreadPoolSize(&pool), n, sum);
+  VectorDispose(&numbers);
+  ThreadPoolDispose(&pool);
+}
+
 /**
  * Function: main
  * --------------
@@ -406,6 +739,11 @@ int main(int ignored, char **alsoIgnored)
   SimpleTest();
   ChallengingTest();
   MemoryTest();
+  CapacityTest();
+  RangeTest();
+  SortTest();
+  TypedTest();
+  ParallelMapTest();
   return 0;
 }
 
@@ -12,6 +12,7 @@
 #include "url.h"
 #include "vector.h"
 #include "hashset.h"
+#include "stringhash.h"
 
 typedef struct {
   char* title;
@@ -23,6 +24,7 @@ typedef struct {
 typedef struct {
   char* word;
   vector* articles;
+  bool sorted;     // whether articles is known to be in SortCmp order
 } entry;
 
 static void Welcome(const char *welcomeTextFileName);
@@ -46,40 +48,18 @@ static void QueryIndices(hashset* entryListPtr, hashset* stopListPtr);
 static void ProcessResponse(const char *word, hashset* entryListPtr, hashset* stopListPtr);
 static bool WordIsWellFormed(const char *word);
 static void buildStopList(hashset* stopList);
-
-static const signed long kHashMultiplier = -1664117991L;
-
-/**
- * Function: StringHash
- * -----------------
- * Used as hash function of hashset of string
-*/
-static int StringHash(const void *elemAddr, int numBuckets)  
-{       
-  char* s = *(char**)elemAddr;     
-  int i;
-  unsigned long hashcode = 0;
-  
-  for (i = 0; i < strlen(s); i++)  
-    hashcode = hashcode * kHashMultiplier + tolower(s[i]);  
-  return hashcode % numBuckets;                                
-}
+static void PrintStats(const hashset* h, const char* name);
 
 /**
  * Function: EntryHash
  * -----------------
  * Used as hash function of hashset of entries
- * Generates hash value with word
+ * Generates hash value with word, ignoring case as EntryCmp does
 */
 static int EntryHash(const void *elemAddr, int numBuckets)  
 {        
   char* s = ((entry*)elemAddr)->word;
-  int i;
-  unsigned long hashcode = 0;
-  
-  for (i = 0; i < strlen(s); i++)  
-    hashcode = hashcode * kHashMultiplier + tolower(s[i]);  
-  return hashcode % numBuckets;                                
+  return StringHashIgnoringCase(s, strlen(s)) % numBuckets;
 }
 
 /**
@@ -161,6 +141,43 @@ int SortCmp(const void* ptr1, const void* ptr2){
   return(a2->frequency - a1->frequency);
 }
 
+/**
+ * Function: PrintStats
+ * --------------------
+ * Prints how evenly the hashset's elements are spread over its buckets,
+ * with a histogram of bucket sizes, and how much memory its buckets hold,
+ * to help pick stopListBuckets and wordListBuckets.  The hashset in
+ * librssnews.a can't report on itself, so this reads the bucket vectors
+ * straight out of the structs declared in hashset.h and vector.h.
+*/
+static const int kMaxReportedChain = 16;
+
+static void PrintStats(const hashset* h, const char* name) {
+  int histogram[kMaxReportedChain + 1];
+  memset(histogram, 0, sizeof(histogram));
+  int numEmpty = 0, maxChain = 0;
+  long bytesAllocated = (long)h->numBuckets * sizeof(vector), bytesUnused = 0;
+  for (int i = 0; i < h->numBuckets; i++) {
+    const vector* v = &h->buckets[i];
+    int length = v->logicalLength;
+    if (length == 0) numEmpty++;
+    if (length > maxChain) maxChain = length;
+    histogram[length < kMaxReportedChain ? length : kMaxReportedChain]++;
+    bytesAllocated += (long)v->allocatedLength * v->elemSize;
+    bytesUnused += (long)(v->allocatedLength - length) * v->elemSize;
+  }
+  int numNonempty = h->numBuckets - numEmpty;
+  printf("%s: %d elements in %d buckets (%d empty, load factor %.2f), nonempty chains %.2f long on average, at most %d\n",
+         name, h->elemCount, h->numBuckets, numEmpty, (double)h->elemCount / h->numBuckets,
+         numNonempty == 0 ? 0 : (double)h->elemCount / numNonempty, maxChain);
+  printf("%s: %ld bytes allocated for buckets, %ld of them unused\n", name, bytesAllocated, bytesUnused);
+  for (int i = 0; i <= kMaxReportedChain; i++) {
+    if (histogram[i] != 0) {
+      printf("%s: %2d%s %9d\n", name, i, i == kMaxReportedChain ? "+" : " ", histogram[i]);
+    }
+  }
+}
+
 /**
  * Function: main
  * --------------
@@ -190,15 +207,24 @@ static const char *const KStopWordsFile = "data/stop-words.txt";
 
 int main(int argc, char **argv) {
   
+  bool printStats = (argc > 1 && strcmp(argv[1], "--stats") == 0);
+  if (printStats) {
+    argc--;
+    argv++;
+  }
   hashset stopList;
   hashset entryList;
   HashSetNew(&entryList, sizeof(entry), wordListBuckets, EntryHash, EntryCmp, FreeEntry);
-  HashSetNew(&stopList, sizeof(char*), stopListBuckets, StringHash, StringCmp, FreeString);
+  HashSetNew(&stopList, sizeof(char*), stopListBuckets, StringHashElementIgnoringCase, StringCmp, FreeString);
   buildStopList(&stopList);
   setbuf(stdout, NULL);
   curl_global_init(CURL_GLOBAL_DEFAULT);
   Welcome(kWelcomeTextFile);
   BuildIndices((argc == 1) ? kDefaultFeedsFile : argv[1], &entryList, &stopList);
+  if (printStats) {
+    PrintStats(&stopList, "stop words");
+    PrintStats(&entryList, "word index");
+  }
   QueryIndices(&entryList, &stopList); 
   HashSetDispose(&stopList);
   HashSetDispose(&entryList);
@@ -603,11 +629,12 @@ static void ScanArticle(streamtokenizer *st, const char *articleTitle,
       SkipIrrelevantContent(st); // in html-utls.h
     } else {
       RemoveEscapeCharacters(word); 
-      char* str = strdup(word);
+      char* str = word;
       if (WordIsWellFormed(word) && HashSetLookup(stopListPtr, &str) == NULL) {
         entry key;
         key.word = strdup(word);
         key.articles = NULL;
+        key.sorted = false;
 
         article toAdd;
         toAdd.frequency = 1;
@@ -623,14 +650,15 @@ static void ScanArticle(streamtokenizer *st, const char *articleTitle,
           URLDispose(&u);
         }
 
-        if (HashSetLookup(entryListPtr, &key) == NULL) { //If hashset doesn't contain word
+        entry* entryAddr = (entry*)HashSetLookup(entryListPtr, &key);
+        if (entryAddr == NULL) { //If hashset doesn't contain word
           vector* v = malloc(sizeof(vector));
           VectorNew(v, sizeof(article), FreeArticle, vectorInitialAllocation);
           VectorAppend(v, &toAdd);
           key.articles = v;
           HashSetEnter(entryListPtr, &key);
         } else { //If hashset contains word
-          entry* entryAddr = (entry*)HashSetLookup(entryListPtr, &key); 
+          entryAddr->sorted = false;
           int index = VectorSearch(entryAddr->articles, &toAdd, ArticleCmp, 0, false);
           if (index < 0) { //If vector of articles doesn't contain article
             VectorAppend(entryAddr->articles, &toAdd);
@@ -643,7 +671,6 @@ static void ScanArticle(streamtokenizer *st, const char *articleTitle,
           free(key.word);
         }
       }
-      free(str);
     }
   }
 }
@@ -686,7 +713,10 @@ static void ProcessResponse(const char *word, hashset* entryListPtr, hashset* st
     e.word = strdup(word);
     entry* entryAddr = (entry*)HashSetLookup(entryListPtr, &e);
     if (entryAddr != NULL) {        
-      VectorSort(entryAddr->articles, SortCmp);
+      if (!entryAddr->sorted) { // only sort again if articles changed since the last query
+        VectorSort(entryAddr->articles, SortCmp);
+        entryAddr->sorted = true;
+      }
       for (int i = 0; i < VectorLength(entryAddr->articles); i++) {
         article* art = (article*)VectorNth(entryAddr->articles, i);
         if (art->frequency == 1) {
@@ -0,0 +1,137 @@
+#include "stringhash.h"
+#include "bool.h"
+#include <assert.h>
+#include <string.h>
+
+/*
+ * Strings of up to sixteen bytes are read as two 64-bit words, built out
+ * of (possibly overlapping) 32-bit reads from either end, or, for one to
+ * three bytes, out of the first, middle and last bytes.  Longer strings
+ * are consumed sixteen bytes at a time, with the last (possibly
+ * overlapping) sixteen bytes playing the part of the two words.  Each
+ * pair of words is folded in by multiplying them (each first xored with
+ * something else) into a 128-bit product whose two halves are then
+ * xored together, and the length is mixed in at the very end.
+ *
+ * Case-folding is done eight bytes at a time as well: a byte is an
+ * uppercase letter if it's at least 'A' and at most 'Z', both of which
+ * can be tested for every byte of a word at once by adding a constant to
+ * its low seven bits and looking at the eighth, provided the byte isn't
+ * already 0x80 or above.  A byte read twice is folded the same way both
+ * times, so the result depends only on the folded string.
+ */
+
+static const uint64_t kPrime0 = 0xa0761d6478bd642full;
+static const uint64_t kPrime1 = 0xe7037ed1a0b428dbull;
+static const uint64_t kPrime2 = 0x8ebc6af09c88c6e3ull;
+static const uint64_t kLowSevenBits = 0x7f7f7f7f7f7f7f7full;
+static const uint64_t kHighBits = 0x8080808080808080ull;
+static const uint64_t kOnes = 0x0101010101010101ull;
+
+static inline uint64_t Mix(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+	unsigned __int128 product = (unsigned __int128)a * b;
+	return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+	uint64_t aLow = (uint32_t)a, aHigh = a >> 32, bLow = (uint32_t)b, bHigh = b >> 32;
+	uint64_t lowLow = aLow * bLow, lowHigh = aLow * bHigh, highLow = aHigh * bLow, highHigh = aHigh * bHigh;
+	uint64_t middle = (lowLow >> 32) + (uint32_t)lowHigh + (uint32_t)highLow;
+	uint64_t low = (middle << 32) | (uint32_t)lowLow;
+	uint64_t high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+	return low ^ high;
+#endif
+}
+
+static inline uint64_t Read64(const char *s)
+{
+	uint64_t word;
+	memcpy(&word, s, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	word = __builtin_bswap64(word);
+#endif
+	return word;
+}
+
+static inline uint64_t Read32(const char *s)
+{
+	uint32_t word;
+	memcpy(&word, s, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	word = __builtin_bswap32(word);
+#endif
+	return word;
+}
+
+static inline uint64_t Read3(const char *s, size_t length)
+{
+	const unsigned char *bytes = (const unsigned char *)s;
+	return ((uint64_t)bytes[0] << 16) | ((uint64_t)bytes[length >> 1] << 8) | bytes[length - 1];
+}
+
+static inline uint64_t FoldCase(uint64_t word)
+{
+	uint64_t low = word & kLowSevenBits;
+	uint64_t atLeastA = low + (0x80 - 'A') * kOnes;
+	uint64_t aboveZ = low + (0x80 - 'Z' - 1) * kOnes;
+	uint64_t upper = atLeastA & ~aboveZ & ~word & kHighBits;
+	return word | (upper >> 2);
+}
+
+static inline uint64_t Hash(const char *s, size_t length, bool foldCase)
+{
+	uint64_t hash = kPrime0, first, second;
+	if (length <= 16) {
+		if (length >= 4) {
+			size_t middle = (length >> 3) << 2;
+			first = (Read32(s) << 32) | Read32(s + middle);
+			second = (Read32(s + length - 4) << 32) | Read32(s + length - 4 - middle);
+		} else {
+			first = (length > 0) ? Read3(s, length) : 0;
+			second = 0;
+		}
+	} else {
+		const char *end = s + length;
+		for (; end - s > 16; s += 16) {
+			first = Read64(s);
+			second = Read64(s + 8);
+			if (foldCase) {
+				first = FoldCase(first);
+				second = FoldCase(second);
+			}
+			hash = Mix(first ^ kPrime1, second ^ hash);
+		}
+		first = Read64(end - 16);
+		second = Read64(end - 8);
+	}
+
+	if (foldCase) {
+		first = FoldCase(first);
+		second = FoldCase(second);
+	}
+	return Mix(length ^ kPrime2, Mix(first ^ kPrime1, second ^ hash));
+}
+
+uint64_t StringHash(const char *s, size_t length)
+{
+	assert(s != NULL || length == 0);
+	return Hash(s, length, false);
+}
+
+uint64_t StringHashIgnoringCase(const char *s, size_t length)
+{
+	assert(s != NULL || length == 0);
+	return Hash(s, length, true);
+}
+
+int StringHashElement(const void *elemAddr, int numBuckets)
+{
+	const char *s = *(char *const *)elemAddr;
+	return StringHash(s, strlen(s)) % numBuckets;
+}
+
+int StringHashElementIgnoringCase(const void *elemAddr, int numBuckets)
+{
+	const char *s = *(char *const *)elemAddr;
+	return StringHashIgnoringCase(s, strlen(s)) % numBuckets;
+}
@@ -0,0 +1,48 @@
+#ifndef _stringhash_
+#define _stringhash_
+#include <stddef.h>
+#include <stdint.h>
+
+/* File: stringhash.h
+ * ------------------
+ * Defines fast, well-mixed hash functions for C strings, along with
+ * ready-made HashSetHashFunctions for the common case of a hashset whose
+ * elements are (or begin with) a char *.  The strings are consumed
+ * sixteen bytes at a time, and every sixteen bytes are folded in with one
+ * wide multiply, in the style of wyhash, so the cost grows with the length
+ * of the string divided by sixteen and the low bits of the result are as
+ * good as the high ones.
+ */
+
+/**
+ * Function: StringHash
+ * --------------------
+ * Returns a 64-bit hash code for the length bytes starting at s.  The
+ * bytes need not be '\0'-terminated, and may include '\0's.
+ */
+
+uint64_t StringHash(const char *s, size_t length);
+
+/**
+ * Function: StringHashIgnoringCase
+ * --------------------------------
+ * Returns a 64-bit hash code for the length bytes starting at s that's
+ * the same for any two strings strcasecmp considers equal (in the "C"
+ * locale, where only 'A' through 'Z' have lowercase versions).
+ */
+
+uint64_t StringHashIgnoringCase(const char *s, size_t length);
+
+/**
+ * Functions: StringHashElement, StringHashElementIgnoringCase
+ * -----------------------------------------------------------
+ * HashSetHashFunctions for hashsets whose elements are char *s, or
+ * structs whose first field is a char *, hashing the '\0'-terminated
+ * string it addresses with StringHash or StringHashIgnoringCase.  Use
+ * the second one when the hashset's compare function is strcasecmp.
+ */
+
+int StringHashElement(const void *elemAddr, int numBuckets);
+int StringHashElementIgnoringCase(const void *elemAddr, int numBuckets);
+
+#endif